@@ -0,0 +1,180 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <algorithm>
+#include "headless.h"
+
+struct BenchmarkOptions {
+    uint32_t frames {1000};
+    uint32_t warmupFrames {60};
+    uint16_t width {800};
+    uint16_t height {600};
+    uint32_t draws {1};
+    bool indirect {false};
+    bool cull {false};
+    bool occlusion {false};
+    bool renderPass {false};
+    std::string output;
+    std::string trace;
+    bool coldPipelineCache {false};
+    std::vector<std::string> meshes;
+    std::vector<std::string> textures;
+    VkDeviceSize textureBudget {0};
+    uint32_t sceneObjects {0};
+    float sceneMoving {0.1f};
+};
+
+struct FrameStatistics {
+    double min;
+    double median;
+    double p99;
+    double max;
+};
+
+BenchmarkOptions parseOptions(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i {1}; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--frames" && hasValue) {
+            options.frames = (uint32_t)std::stoul(argv[++i]);
+        } else if (argument == "--warmup" && hasValue) {
+            options.warmupFrames = (uint32_t)std::stoul(argv[++i]);
+        } else if (argument == "--width" && hasValue) {
+            options.width = (uint16_t)std::stoul(argv[++i]);
+        } else if (argument == "--height" && hasValue) {
+            options.height = (uint16_t)std::stoul(argv[++i]);
+        } else if (argument == "--draws" && hasValue) {
+            options.draws = (uint32_t)std::stoul(argv[++i]);
+        } else if (argument == "--indirect") {
+            options.indirect = true;
+        } else if (argument == "--cull") {
+            options.cull = true;
+        } else if (argument == "--occlusion") {
+            options.cull = true;
+            options.occlusion = true;
+        } else if (argument == "--render-pass") {
+            options.renderPass = true;
+        } else if (argument == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else if (argument == "--trace" && hasValue) {
+            options.trace = argv[++i];
+        } else if (argument == "--cold") {
+            options.coldPipelineCache = true;
+        } else if (argument == "--mesh" && hasValue) {
+            options.meshes.push_back(argv[++i]);
+        } else if (argument == "--texture" && hasValue) {
+            options.textures.push_back(argv[++i]);
+        } else if (argument == "--texture-budget" && hasValue) {
+            options.textureBudget = (VkDeviceSize)std::stoull(argv[++i]) * 1024 * 1024;
+        } else if (argument == "--scene" && hasValue) {
+            options.sceneObjects = (uint32_t)std::stoul(argv[++i]);
+        } else if (argument == "--scene-moving" && hasValue) {
+            options.sceneMoving = std::stof(argv[++i]);
+        } else {
+            throw std::runtime_error("unknown argument: " + argument);
+        }
+    }
+    return options;
+}
+
+FrameStatistics computeStatistics(std::vector<double> samples) {
+    if (samples.empty()) {
+        return {};
+    }
+    std::sort(samples.begin(), samples.end());
+    return { samples.front(), percentile(samples, 0.5), percentile(samples, 0.99), samples.back() };
+}
+
+void writeStatistics(FILE* file, const char* name, const FrameStatistics& statistics, bool last) {
+    fprintf(file, "    \"%s\": { \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+        name, statistics.min, statistics.median, statistics.p99, statistics.max, last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    enableAnsiColors();
+    try {
+        BenchmarkOptions options = parseOptions(argc, argv);
+
+        if (options.coldPipelineCache) {
+            remove(PIPELINE_CACHE_FILENAME);
+        }
+
+        Headless headless(options.width, options.height, !options.renderPass);
+        double meshLoadMilliseconds = options.meshes.empty() ? 0.0 : headless.loadMeshes(options.meshes);
+        headless.setDraws(options.draws, options.indirect, options.cull, options.occlusion);
+        // streams during warmup and the measured frames, so its uploads show up in the frame times
+        headless.loadTextures(options.textures, options.textureBudget);
+        if (options.sceneObjects > 0) {
+            headless.setScene(options.sceneObjects, options.sceneMoving);
+        }
+
+        for (uint32_t i {0}; i < options.warmupFrames; i++) {
+            headless.render();
+        }
+        headless.finish();
+        headless.gpuFrameTimes.clear();
+        if (!options.trace.empty()) {
+            headless.startTrace();
+        }
+
+        std::vector<double> cpuFrameTimes;
+        cpuFrameTimes.reserve(options.frames);
+        for (uint32_t i {0}; i < options.frames; i++) {
+            auto start = std::chrono::steady_clock::now();
+            headless.render();
+            auto end = std::chrono::steady_clock::now();
+            cpuFrameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        headless.finish();
+        if (!options.trace.empty() && !headless.writeTrace(options.trace)) {
+            throw std::runtime_error("could not write trace: " + options.trace);
+        }
+
+        FILE* file = options.output.empty() ? stdout : fopen(options.output.c_str(), "w");
+        if (!file) {
+            throw std::runtime_error("could not open benchmark output: " + options.output);
+        }
+        fprintf(file, "{\n");
+        fprintf(file, "  \"frames\": %u,\n", options.frames);
+        fprintf(file, "  \"width\": %u,\n", options.width);
+        fprintf(file, "  \"height\": %u,\n", options.height);
+        fprintf(file, "  \"draws\": %u,\n", options.draws);
+        fprintf(file, "  \"indirect\": %s,\n", options.indirect ? "true" : "false");
+        fprintf(file, "  \"cull\": %s,\n", options.cull ? "true" : "false");
+        fprintf(file, "  \"occlusion\": %s,\n", headless.occlusion ? "true" : "false");
+        fprintf(file, "  \"dynamicRendering\": %s,\n", headless.dynamicRendering ? "true" : "false");
+        fprintf(file, "  \"meshes\": { \"streamed\": %zu, \"loadMs\": %.4f },\n", options.meshes.size(), meshLoadMilliseconds);
+        fprintf(file, "  \"scene\": { \"objects\": %u, \"moving\": %.4f },\n", options.sceneObjects, options.sceneMoving);
+        VulkanTextureStats textureStats = headless.textureStats();
+        fprintf(file, "  \"textures\": { \"loaded\": %u, \"residentMips\": %u, \"residentBytes\": %llu, \"budgetBytes\": %llu, \"streamedBytes\": %llu, \"evictedMips\": %u },\n",
+            textureStats.textureCount, textureStats.residentMips, (unsigned long long)textureStats.residentBytes, (unsigned long long)textureStats.budget,
+            (unsigned long long)textureStats.streamedBytes, textureStats.evictedMips);
+        fprintf(file, "  \"pipelineCache\": { \"warm\": %s, \"loadedBytes\": %zu, \"pipelines\": %u, \"creationMs\": %.4f },\n",
+            headless.pipelineCacheStats.warm ? "true" : "false", headless.pipelineCacheStats.loadedBytes,
+            headless.pipelineCacheStats.pipelineCount, headless.pipelineCacheStats.creationMilliseconds);
+        fprintf(file, "  \"frameTimeMs\": {\n");
+        writeStatistics(file, "cpu", computeStatistics(cpuFrameTimes), false);
+        writeStatistics(file, "gpu", computeStatistics(headless.gpuFrameTimes), true);
+        fprintf(file, "  },\n");
+        // rolling window over the last frames, so these describe the end of the run
+        std::vector<VulkanScopeStatistics> scopes = headless.scopeStatistics();
+        fprintf(file, "  \"scopesMs\": [\n");
+        for (size_t i {0}; i < scopes.size(); i++) {
+            fprintf(file, "    { \"name\": \"%s\", \"gpu\": %s, \"median\": %.4f, \"p95\": %.4f, \"p99\": %.4f }%s\n",
+                scopes[i].name.c_str(), scopes[i].gpu ? "true" : "false", scopes[i].median, scopes[i].p95, scopes[i].p99, i + 1 == scopes.size() ? "" : ",");
+        }
+        fprintf(file, "  ]\n");
+        fprintf(file, "}\n");
+        if (file != stdout) {
+            fclose(file);
+        }
+
+        headless.clean();
+    } catch(std::exception& exception) {
+        LOG(LOG_ERROR_UTILS, false, "std::exception: %s", exception.what());
+        return 1;
+    }
+    return 0;
+}
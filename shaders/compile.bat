@@ -1,2 +1,5 @@
 glslc.exe -fshader-stage=vert default-vert.glsl -o ../bin/spvs/default-vert.spv
-glslc.exe -fshader-stage=frag default-frag.glsl -o ../bin/spvs/default-frag.spv
\ No newline at end of file
+glslc.exe -fshader-stage=frag default-frag.glsl -o ../bin/spvs/default-frag.spv
+glslc.exe -fshader-stage=vert instanced-vert.glsl -o ../bin/spvs/instanced-vert.spv
+glslc.exe -fshader-stage=comp cull-comp.glsl -o ../bin/spvs/cull-comp.spv
+glslc.exe -fshader-stage=comp hiz-comp.glsl -o ../bin/spvs/hiz-comp.spv
\ No newline at end of file
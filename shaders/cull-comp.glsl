@@ -0,0 +1,99 @@
+#version 450 core
+
+layout(local_size_x = 64) in;
+
+struct Mesh {
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    float radius;
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(set = 0, binding = 0) uniform CullParameters {
+    mat4 viewProjection;
+    vec4 planes[6];
+    vec4 cameraPosition;
+    vec2 projectionScale;
+    vec2 hiZSize;
+    uint objectCount;
+    uint hiZEnabled;
+    uint compact;
+} params;
+
+// xyz position, w scale
+layout(std430, set = 0, binding = 1) readonly buffer Instances { vec4 instances[]; };
+layout(std430, set = 0, binding = 2) readonly buffer MeshIds { uint meshIds[]; };
+layout(std430, set = 0, binding = 3) readonly buffer Meshes { Mesh meshes[]; };
+layout(std430, set = 0, binding = 4) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, set = 0, binding = 5) writeonly buffer VisibleInstances { vec4 visibleInstances[]; };
+layout(std430, set = 0, binding = 6) buffer DrawCount { uint drawCount; };
+// max depth pyramid of the previous frame
+layout(set = 0, binding = 7) uniform sampler2D hiZ;
+
+bool isOccluded(vec3 center, float radius) {
+    vec4 clip = params.viewProjection * vec4(center, 1.0);
+    // spheres crossing the near plane are never culled
+    if (clip.w <= radius) {
+        return false;
+    }
+
+    vec2 ndc = clip.xy / clip.w;
+    vec2 ndcRadius = params.projectionScale * radius / clip.w;
+    vec2 uvMin = clamp((ndc - ndcRadius) * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uvMax = clamp((ndc + ndcRadius) * 0.5 + 0.5, 0.0, 1.0);
+
+    vec3 towardsCamera = normalize(params.cameraPosition.xyz - center);
+    vec4 nearestClip = params.viewProjection * vec4(center + towardsCamera * radius, 1.0);
+    float nearestDepth = nearestClip.z / nearestClip.w;
+
+    // pick the mip where the footprint covers about 2x2 texels so four samples are conservative
+    vec2 footprint = (uvMax - uvMin) * params.hiZSize;
+    float lod = ceil(log2(max(max(footprint.x, footprint.y), 1.0)));
+    float depth = max(max(textureLod(hiZ, uvMin, lod).r, textureLod(hiZ, vec2(uvMax.x, uvMin.y), lod).r),
+                      max(textureLod(hiZ, vec2(uvMin.x, uvMax.y), lod).r, textureLod(hiZ, uvMax, lod).r));
+    return nearestDepth > depth;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= params.objectCount) {
+        return;
+    }
+
+    vec4 instance = instances[index];
+    Mesh mesh = meshes[meshIds[index]];
+    vec3 center = instance.xyz;
+    float radius = mesh.radius * instance.w;
+
+    bool visible = true;
+    for (int i = 0; i < 6; i++) {
+        visible = visible && dot(params.planes[i].xyz, center) + params.planes[i].w >= -radius;
+    }
+    if (visible && params.hiZEnabled != 0) {
+        visible = !isOccluded(center, radius);
+    }
+
+    // compacted output needs draw indirect count, otherwise every object keeps its slot and culled ones draw zero instances
+    uint slot = index;
+    if (params.compact != 0) {
+        if (!visible) {
+            return;
+        }
+        slot = atomicAdd(drawCount, 1);
+    }
+
+    commands[slot].indexCount = mesh.indexCount;
+    commands[slot].instanceCount = visible ? 1 : 0;
+    commands[slot].firstIndex = mesh.firstIndex;
+    commands[slot].vertexOffset = mesh.vertexOffset;
+    commands[slot].firstInstance = slot;
+    visibleInstances[slot] = instance;
+}
@@ -0,0 +1,33 @@
+#version 450 core
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// the depth buffer for the first level, the previous pyramid level after that
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform Parameters {
+    ivec2 sourceSize;
+    ivec2 destinationSize;
+} params;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, params.destinationSize))) {
+        return;
+    }
+
+    // farthest of the covered source texels, odd sizes fold the extra row and column in
+    ivec2 base = texel * 2;
+    ivec2 last = params.sourceSize - 1;
+    float depth = 0.0;
+    for (int y = 0; y < 3; y++) {
+        for (int x = 0; x < 3; x++) {
+            if ((x == 2 && (params.sourceSize.x & 1) == 0) || (y == 2 && (params.sourceSize.y & 1) == 0)) {
+                continue;
+            }
+            depth = max(depth, texelFetch(source, min(base + ivec2(x, y), last), 0).r);
+        }
+    }
+    imageStore(destination, texel, vec4(depth));
+}
@@ -0,0 +1,13 @@
+#version 450 core
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 instancePosition;
+layout(location = 3) in float instanceScale;
+
+layout(location = 0) out vec3 vertex_color;
+
+void main() {
+    gl_Position = vec4(inPosition * instanceScale + instancePosition.xy, instancePosition.z, 1.0);
+    vertex_color = inColor;
+}
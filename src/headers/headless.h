@@ -0,0 +1,66 @@
+#pragma once
+#include "vulkan-base.h"
+
+class Headless {
+private:
+    VulkanContext* context;
+    VulkanImage target;
+    // VK_NULL_HANDLE and no framebuffers when rendering dynamically
+    VkRenderPass renderPass;
+    std::vector<VkFramebuffer> framebuffers;
+    VulkanPipelineDescription pipelineDescription;
+    VulkanPipelineDescription instancedPipelineDescription;
+    // the instanced pipeline with a depth attachment, for the occlusion test
+    VulkanPipelineDescription occlusionPipelineDescription;
+    std::array<VulkanFrame, MAX_FRAMES_IN_FLIGHT> frames;
+    uint32_t frameIndex {0};
+
+    VulkanBuffer vertexBuffer;
+    VulkanDrawList drawList;
+    uint32_t draws {1};
+    bool indirect {false};
+    VulkanCuller culler {};
+    bool culling {false};
+    // single sampled and stored, the pyramid built from it is tested against by the next frame's culling pass
+    VulkanImage depth {};
+    VulkanHiZ hiZ {};
+    std::vector<uint32_t> textures;
+    VulkanScene scene {};
+    std::vector<uint32_t> movingEntities;
+    uint32_t sceneFrame {0};
+
+    void collectGpuTiming(const VulkanFrame& frame);
+
+public:
+    uint16_t width;
+    uint16_t height;
+    std::vector<double> gpuFrameTimes;
+    VulkanPipelineCacheStats pipelineCacheStats;
+    bool dynamicRendering {false};
+    bool occlusion {false};
+
+    // dynamic rendering is used where supported unless turned off, the render pass path stays for comparison
+    Headless(const uint16_t width, const uint16_t height, bool useDynamicRendering = true);
+    void setupVulkan(bool useDynamicRendering);
+    // per-draw mode issues one vkCmdDraw per object and goes wide across the thread pool once there are enough of them
+    // indirect mode spreads the objects as instances over the draw list meshes and issues a single indirect call
+    // culling additionally lets a compute pass build the indirect commands from the visible instances
+    // occlusion also tests them against the depth of the previous frame, it needs culling and dynamic rendering
+    void setDraws(uint32_t count, bool useIndirect, bool useCulling = false, bool useOcclusion = false);
+    // streams converted meshes into the draw list next to the built in ones, blocks until they are resident
+    // and returns how many milliseconds that took
+    double loadMeshes(const std::vector<std::string>& filenames);
+    // returns right away, the textures stream in over the following frames within the budget (0 keeps the default)
+    void loadTextures(const std::vector<std::string>& filenames, VkDeviceSize budget);
+    VulkanTextureStats textureStats();
+    // a hierarchy of objects in groups of 16 (a root, three children with four leaves each), the given fraction of roots
+    // turns every frame so their whole subtrees are updated and written to the object buffer
+    void setScene(uint32_t objects, float moving);
+    void render();
+    void finish();
+    // everything profiled between the two calls ends up in a chrome trace json
+    void startTrace();
+    bool writeTrace(const std::string& filename);
+    std::vector<VulkanScopeStatistics> scopeStatistics();
+    void clean();
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void(uint32_t)>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsDone;
+    uint32_t activeJobs {0};
+    bool stopping {false};
+
+    void work(uint32_t workerIndex);
+
+public:
+    ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+    // jobs receive the index of the worker running them, so callers can keep per-worker state without locking
+    void submit(std::function<void(uint32_t)> job);
+    void wait();
+    // runs job(index, workerIndex) for every index and returns when all are done, the calling thread helps out as worker size()
+    // these jobs jump ahead of queued work so a long background job never stalls the frame
+    void parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& job);
+    uint32_t size() const { return (uint32_t)workers.size(); }
+};
@@ -1,7 +1,10 @@
 #pragma once
 #include <iostream>
 #include <vector>
+#include <string>
 #include <array>
+#include <cstring>
+#include <functional>
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
@@ -16,10 +19,33 @@
 
 
 const size_t MAX_FRAMES_IN_FLIGHT = 2;
+const VkDeviceSize UPLOAD_RING_SIZE = 32ull * 1024 * 1024;
+const VkDeviceSize FRAME_TRANSIENT_SIZE = 4ull * 1024 * 1024;
+const uint32_t FRAME_DESCRIPTOR_COUNT = 256;
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 1024 * 1024;
+const VkDeviceSize UNIFORM_RING_RANGE = 64 * 1024;
+const uint32_t BINDLESS_TEXTURE_COUNT = 4096;
+const uint32_t BINDLESS_BUFFER_COUNT = 1024;
+const char* const PIPELINE_CACHE_FILENAME = "pipeline-cache.bin";
+const VkDeviceSize MESH_STREAM_FRAME_BUDGET = 8ull * 1024 * 1024;
 
+// every submission to a queue signals its timeline with the next value, so "done" is just a counter comparison
 struct VulkanQueue {
     VkQueue queue;
     uint32_t familyIndex;
+    VkSemaphore timeline;
+    // value signaled by the latest submission
+    uint64_t submitted;
+};
+// VSYNC is plain fifo, every other policy falls back to it when the surface lacks the preferred modes
+enum VulkanPresentPolicy {
+    PRESENT_POLICY_VSYNC,
+    // fifo relaxed, late frames tear instead of waiting a whole refresh
+    PRESENT_POLICY_ADAPTIVE_VSYNC,
+    // mailbox then immediate, the newest frame is shown at the next refresh
+    PRESENT_POLICY_LOW_LATENCY,
+    // immediate then mailbox, uncapped frame rate for benchmarking
+    PRESENT_POLICY_THROUGHPUT
 };
 struct VulkanSwapchain {
     VkSwapchainKHR swapchain;
@@ -28,68 +54,834 @@ struct VulkanSwapchain {
     VkFormat format;
     std::vector<VkImage> images;
     std::vector<VkImageView> imageViews;
+    VulkanPresentPolicy policy;
+    VkPresentModeKHR presentMode;
+    // id of the last present, stays 0 without present wait
+    uint64_t presentId;
+    // glfw time each pending present sampled its input at, indexed by presentId
+    std::array<double, 8> inputTimes;
 };
 struct VulkanPipeline {
     VkPipeline pipeline;
+    // owned by the layout cache, pipelines with the same sets and push constants share it and stay compatible
     VkPipelineLayout pipelineLayout;
+    std::vector<VkDescriptorSetLayout> setLayouts;
+};
+// everything that ends up in the compiled pipeline, identical descriptions share one VkPipeline
+struct VulkanPipelineDescription {
+    std::string vertexShader;
+    std::string fragmentShader;
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    VkPrimitiveTopology topology {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    VkPolygonMode polygonMode {VK_POLYGON_MODE_FILL};
+    VkCullModeFlags cullMode {VK_CULL_MODE_NONE};
+    VkFrontFace frontFace {VK_FRONT_FACE_COUNTER_CLOCKWISE};
+    bool blendEnable {false};
+    VkBlendFactor srcColorBlendFactor {VK_BLEND_FACTOR_ONE};
+    VkBlendFactor dstColorBlendFactor {VK_BLEND_FACTOR_ZERO};
+    VkBlendOp colorBlendOp {VK_BLEND_OP_ADD};
+    VkRenderPass renderPass {VK_NULL_HANDLE};
+    uint32_t subpass {0};
+    // without a render pass the pipeline is created for dynamic rendering into these formats, undefined leaves the attachment out
+    VkFormat colorFormat {VK_FORMAT_UNDEFINED};
+    VkFormat depthFormat {VK_FORMAT_UNDEFINED};
+    VkSampleCountFlagBits samples {VK_SAMPLE_COUNT_1_BIT};
+    bool depthTest {false};
+    bool depthWrite {false};
+    VkCompareOp depthCompareOp {VK_COMPARE_OP_LESS_OR_EQUAL};
+    // become the pipeline layout, set layouts are owned by the caller and compared by handle
+    // left empty they are reflected from the shaders, which can't tell dynamic buffers or runtime arrays apart
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstants;
+    // constant id and 32 bit value, applied to every stage that declares the id
+    std::vector<std::pair<uint32_t, uint32_t>> specializationConstants;
+};
+class ThreadPool;
+struct VulkanAllocator;
+struct VulkanUploader;
+struct VulkanPipelineRegistry;
+struct VulkanRecorder;
+struct VulkanUniformRing;
+struct VulkanBindlessTable;
+struct VulkanDeletionQueue;
+struct VulkanProfiler;
+struct VulkanShaderLibrary;
+struct VulkanLayoutCache;
+struct VulkanRenderGraph;
+struct VulkanTextureStreamer;
+struct VulkanAllocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void* mapped;
+    uint32_t memoryTypeIndex;
+    void* handle;
+};
+struct VulkanMemoryStats {
+    uint32_t blockCount;
+    uint32_t allocationCount;
+    VkDeviceSize reservedBytes;
+    VkDeviceSize usedBytes;
+    VkDeviceSize largestFreeRange;
+    float fragmentation;
+};
+struct VulkanBuffer {
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+    VkDeviceSize size;
+};
+struct VulkanImage {
+    VkImage image;
+    VulkanAllocation allocation;
+    VkImageView imageView;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    VkFormat format;
+};
+// grows by whole pools instead of failing, a reset hands every pool back at once
+struct VulkanDescriptorAllocator {
+    std::vector<VkDescriptorPool> usedPools;
+    std::vector<VkDescriptorPool> freePools;
+    VkDescriptorPool currentPool;
+    uint32_t setsPerPool;
+};
+// everything a frame in flight owns, reset in bulk once the graphics timeline passed its last submission
+struct VulkanFrame {
+    uint32_t index;
+    // graphics timeline value signaled by the last submission of this frame
+    uint64_t timelineValue;
+    VkSemaphore acquireSemaphore;
+    VkSemaphore releaseSemaphore;
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VulkanDescriptorAllocator descriptors;
+    VulkanBuffer transientBuffer;
+    VkDeviceSize transientOffset;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    // 0 for binary semaphores
+    std::vector<uint64_t> waitValues;
+    // gpu time of the previous submission of this frame, negative without timestamps
+    double gpuMilliseconds;
+};
+struct VulkanPipelineCacheStats {
+    bool warm;
+    size_t loadedBytes;
+    uint32_t pipelineCount;
+    double creationMilliseconds;
+};
+struct VulkanDeviceFeatures {
+    bool multiDrawIndirect;
+    bool drawIndirectFirstInstance;
+    bool drawIndirectCount;
+    // bindless table, core descriptor indexing from vulkan 1.2
+    bool descriptorIndexing;
+    // VK_KHR_present_id and VK_KHR_present_wait, windowed contexts only
+    bool presentWait;
+    // core dynamic rendering and synchronization2 from vulkan 1.3
+    bool dynamicRendering;
+    // block compressed textures, desktop gpus have bc and mobile ones astc
+    bool textureCompressionBC;
+    bool textureCompressionASTC;
 };
 struct VulkanContext {
     VkInstance instance;
     VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties physicalDeviceProperties;
     VkDevice device;
+    VulkanDeviceFeatures features;
     VulkanQueue graphicsQueue;
+    VulkanQueue transferQueue;
+    VulkanAllocator* allocator;
+    VulkanUploader* uploader;
+    VkPipelineCache pipelineCache;
+    std::string pipelineCacheFilename;
+    VulkanPipelineCacheStats pipelineCacheStats;
+    VulkanPipelineRegistry* pipelineRegistry;
+    ThreadPool* threadPool;
+    VulkanRecorder* recorder;
+    VulkanUniformRing* uniformRing;
+    // nullptr without descriptor indexing
+    VulkanBindlessTable* bindless;
+    VulkanDeletionQueue* deletionQueue;
+    VulkanProfiler* profiler;
+    VulkanShaderLibrary* shaderLibrary;
+    VulkanLayoutCache* layoutCache;
+    VulkanTextureStreamer* textureStreamer;
+    bool headless;
 };
 
-void initVulkan(VulkanContext*& context);
+void initVulkan(VulkanContext*& context, bool headless = false);
 void cleanVulkan(VulkanContext*& context);
 
-void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage, VulkanSwapchain& swapchain);
+// release (on source) and acquire (on destination) use the same barrier, the queues also need a semaphore between them
+VkBufferMemoryBarrier queueOwnershipBarrier(const VulkanBuffer& buffer, const VulkanQueue& source, const VulkanQueue& destination, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
+VkImageMemoryBarrier queueOwnershipBarrier(const VulkanImage& image, const VulkanQueue& source, const VulkanQueue& destination, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
+
+void createTimeline(VulkanContext* context, VulkanQueue& queue);
+void destroyTimeline(VulkanContext* context, VulkanQueue& queue);
+uint64_t completedTimelineValue(VulkanContext* context, const VulkanQueue& queue);
+void waitTimeline(VulkanContext* context, const VulkanQueue& queue, uint64_t value);
+
+void createDeletionQueue(VulkanContext* context);
+void destroyDeletionQueue(VulkanContext* context);
+// graphics timeline value the frame currently being recorded will signal, store it on an object to remember its last use
+uint64_t recordingSerial(VulkanContext* context);
+// runs destroy once the graphics timeline reached lastUsedSerial, 0 means every frame submitted so far and the one being recorded
+void deferDeletion(VulkanContext* context, std::function<void()> destroy, uint64_t lastUsedSerial = 0);
+// take the handles and reset the passed object, so it can be recreated right away
+void deferDestroyBuffer(VulkanContext* context, VulkanBuffer& buffer, uint64_t lastUsedSerial = 0);
+void deferDestroyImage(VulkanContext* context, VulkanImage& image, uint64_t lastUsedSerial = 0);
+void deferDestroyPipeline(VulkanContext* context, VulkanPipeline& pipeline, uint64_t lastUsedSerial = 0);
+void deferDestroyFramebuffers(VulkanContext* context, std::vector<VkFramebuffer>& framebuffers, uint64_t lastUsedSerial = 0);
+void collectDeletions(VulkanContext* context);
+// waits for the device and runs everything still pending, e.g. before the surface goes away
+void flushDeletions(VulkanContext* context);
+
+void createAllocator(VulkanContext* context);
+void destroyAllocator(VulkanContext* context);
+void allocateMemory(VulkanContext* context, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, VulkanAllocation& allocation);
+void freeMemory(VulkanContext* context, VulkanAllocation& allocation);
+void getMemoryStats(VulkanContext* context, VulkanMemoryStats& stats);
+void logMemoryStats(VulkanContext* context);
+// the callback copies the contents and rebinds the resource, the old range is released afterwards
+typedef std::function<void(const VulkanAllocation& source, const VulkanAllocation& destination)> VulkanDefragmentationMove;
+uint32_t defragmentMemory(VulkanContext* context, std::vector<VulkanAllocation*>& allocations, const VulkanDefragmentationMove& move);
+
+void createUploader(VulkanContext* context, VkDeviceSize ringSize);
+void destroyUploader(VulkanContext* context);
+void uploadBuffer(VulkanContext* context, VulkanBuffer& buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+void uploadImage(VulkanContext* context, VulkanImage& image, uint32_t mipLevel, const void* data, VkDeviceSize size, VkImageLayout finalLayout);
+void flushUploads(VulkanContext* context);
+// records the acquire half of every flushed batch into the frame and makes the frame wait for the transfer timeline
+void acquireUploads(VulkanContext* context, VulkanFrame& frame);
+void retireUploads(VulkanContext* context);
+void waitUploads(VulkanContext* context);
+
+void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage, VulkanSwapchain& swapchain, VulkanPresentPolicy policy = PRESENT_POLICY_VSYNC, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+// hands the old swapchain to the new one and defers destroying it, its views and framebuffers until the frames using them retired
 void recreateSwapchain(GLFWwindow* window, VulkanContext* context, VulkanSwapchain& swapchain, std::vector<VkFramebuffer>& framebuffers, VkSurfaceKHR& surface, VkRenderPass& renderPass);
 void destroySwapchain(VulkanContext* context, VulkanSwapchain* swapchain, std::vector<VkFramebuffer>& framebuffers);
+// tags the present with the next present id when present wait is available
+VkResult presentSwapchain(VulkanContext* context, VulkanSwapchain& swapchain, uint32_t imageIndex, VkSemaphore waitSemaphore, double inputTime);
+// blocks until at most maxQueuedPresents are still waiting for the display, returns the input to display latency
+// of the present that was waited for in milliseconds, or a negative value if nothing was measured
+double pacePresents(VulkanContext* context, VulkanSwapchain& swapchain, uint32_t maxQueuedPresents);
 
-void createRenderPass(VulkanContext* context, VkFormat format, VkRenderPass& renderPass);
+void createRenderPass(VulkanContext* context, VkFormat format, VkRenderPass& renderPass, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+// attachment 0 is the image that ends up in finalLayout (the resolve target with msaa), followed by depth and the multisampled color if used
+// depth and multisampled color are transient, they are neither loaded nor stored
+void createRenderPass(VulkanContext* context, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkRenderPass& renderPass, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 void destroyRenderpass(VulkanContext* context, VkRenderPass renderPass);
+// single image layout transition through synchronization2, the dynamic rendering path does these instead of subpass dependencies
+void transitionImage(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspectMask, VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask);
 
 void createFramebuffers(VulkanContext* context, VulkanSwapchain& swapchain, VkRenderPass& renderPass, std::vector<VkFramebuffer>& framebuffers);
+// one framebuffer per image view, sharedAttachments (depth, multisampled color) are appended to each of them
+void createFramebuffers(VulkanContext* context, const std::vector<VkImageView>& imageViews, uint32_t width, uint32_t height, VkRenderPass& renderPass, std::vector<VkFramebuffer>& framebuffers,
+    const std::vector<VkImageView>& sharedAttachments = {});
 void destroyFramebuffers(VulkanContext* context, std::vector<VkFramebuffer>& framebuffers);
 
+struct VulkanReflectedInput {
+    uint32_t location;
+    VkFormat format;
+    uint32_t size;
+};
+struct VulkanReflectedBinding {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    // 0 for runtime arrays
+    uint32_t count;
+};
+struct VulkanShaderReflection {
+    VkShaderStageFlagBits stage;
+    // vertex shaders only, sorted by location
+    std::vector<VulkanReflectedInput> inputs;
+    std::vector<VulkanReflectedBinding> bindings;
+    uint32_t pushConstantSize;
+    // constant id and size in bytes
+    std::vector<std::pair<uint32_t, uint32_t>> specializationConstants;
+};
+// reads the spir-v directly, throws on modules it can't make sense of
+void reflectShader(const uint32_t* code, size_t wordCount, VulkanShaderReflection& reflection);
+// every input in binding 0, tightly packed in location order
+void reflectVertexInput(const VulkanShaderReflection& reflection, std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes);
+// one range covering the push constant blocks of all stages
+void reflectPushConstants(const std::vector<const VulkanShaderReflection*>& stages, std::vector<VkPushConstantRange>& pushConstants);
+// merges the bindings and push constants of all stages into cached layouts
+void reflectPipelineLayout(VulkanContext* context, const std::vector<const VulkanShaderReflection*>& stages,
+    std::vector<VkDescriptorSetLayout>& setLayouts, std::vector<VkPushConstantRange>& pushConstants);
+
+// identical descriptions return the same handle, the cache owns them until the device is destroyed
+void createLayoutCache(VulkanContext* context);
+void destroyLayoutCache(VulkanContext* context);
+VkDescriptorSetLayout getDescriptorSetLayout(VulkanContext* context, std::vector<VkDescriptorSetLayoutBinding> bindings);
+VkPipelineLayout getPipelineLayout(VulkanContext* context, const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+
+// read only view of a whole file, page aligned so its contents go to vulkan or into staging memory without parsing
+struct VulkanMappedFile {
+    const uint8_t* data;
+    size_t size;
+    // windows only, the file and mapping handles
+    void* file;
+    void* mapping;
+};
+bool mapFile(const std::string& filename, VulkanMappedFile& mapped);
+void unmapFile(VulkanMappedFile& mapped);
+// faults the range in on the calling thread
+void prefetchFile(const VulkanMappedFile& mapped, size_t offset, size_t size);
+
+void createShaderLibrary(VulkanContext* context);
+void destroyShaderLibrary(VulkanContext* context);
+// maps and validates the spir-v on first use, files with the same code share one module
+// safe to call from several threads, every acquire is released once the pipeline is created
+VkShaderModule acquireShaderModule(VulkanContext* context, const std::string& filename, VulkanShaderReflection* reflection = nullptr);
+void releaseShaderModule(VulkanContext* context, VkShaderModule module);
+// picks up rewritten shader files and rebuilds the pipelines using them in the background, cheap enough to call every frame
+// returns the number of shaders that changed
+uint32_t pollShaderLibrary(VulkanContext* context);
+
+void createPipelineCache(VulkanContext* context, const char* filename);
+void savePipelineCache(VulkanContext* context);
+void destroyPipelineCache(VulkanContext* context);
+uint64_t hashPipelineDescription(const VulkanPipelineDescription& description);
+bool operator==(const VulkanPipelineDescription& a, const VulkanPipelineDescription& b);
+VulkanPipelineDescription defaultPipelineDescription(const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass);
+VulkanPipelineDescription defaultPipelineDescription(const char* vertexShaderFilename, const char* fragmentShaderFilename, VkFormat colorFormat);
 void createPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VulkanPipeline& pipeline);
+void createPipeline(VulkanContext* context, const VulkanPipelineDescription& description, VulkanPipeline& pipeline);
+void createComputePipeline(VulkanContext* context, const char* shaderFilename, const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize, VulkanPipeline& pipeline);
+// set layouts and push constants reflected from the shader, pipeline.setLayouts has them for allocating sets
+void createComputePipeline(VulkanContext* context, const char* shaderFilename, VulkanPipeline& pipeline);
 void destroyPipeline(VulkanContext* context, VulkanPipeline* pipeline);
 
-void createFence(VulkanContext* context, std::vector<VkFence>& fences);
-void createSemaphore(VulkanContext* context, std::vector<VkSemaphore>& semaphores);
-void createCommandPool(VulkanContext* context, VkCommandPool* commandPool);
-void destroySyncObjects(VulkanContext* context, std::vector<VkSemaphore>& acquireSemaphores, std::vector<VkSemaphore>& releaseSemaphores, std::vector<VkFence>& fences);
+void createPipelineRegistry(VulkanContext* context);
+void destroyPipelineRegistry(VulkanContext* context);
+// never blocks, misses are compiled on the thread pool and nullptr is returned until the pipeline is ready
+const VulkanPipeline* requestPipeline(VulkanContext* context, const VulkanPipelineDescription& description);
+void waitPipelines(VulkanContext* context);
+// drops a compiled pipeline so the next request builds it again, the old one is destroyed once in-flight frames retired
+// returns false while it is still compiling
+bool evictPipeline(VulkanContext* context, const VulkanPipelineDescription& description);
+// compiles the pipelines using the shader again, requests keep getting the current ones until the new ones are ready
+// returns the number of pipelines rebuilt
+uint32_t reloadPipelines(VulkanContext* context, const std::string& shaderFilename);
+
+void createRecorder(VulkanContext* context);
+void destroyRecorder(VulkanContext* context);
+void resetRecorder(VulkanContext* context, uint32_t frameIndex);
+// records draws [firstDraw, firstDraw + drawCount), called from worker threads with a secondary command buffer that inherits the render pass
+typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)> VulkanRecordCallback;
+// begins and ends the render pass, large draw counts are split across the thread pool and stitched with vkCmdExecuteCommands
+void recordRenderPass(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& beginInfo, uint32_t drawCount, const VulkanRecordCallback& record);
+// the same for dynamic rendering, secondaries inherit the attachment formats instead of a render pass and framebuffer
+// VK_FORMAT_UNDEFINED leaves out the color or depth attachment
+void recordRendering(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo, VkFormat colorFormat, VkFormat depthFormat,
+    VkSampleCountFlagBits samples, uint32_t drawCount, const VulkanRecordCallback& record);
+
+void createFrames(VulkanContext* context, std::array<VulkanFrame, MAX_FRAMES_IN_FLIGHT>& frames);
+void destroyFrames(VulkanContext* context, std::array<VulkanFrame, MAX_FRAMES_IN_FLIGHT>& frames);
+// blocks until the graphics timeline reached the last submission of the frame
+void waitFrame(VulkanContext* context, VulkanFrame& frame);
+// resets the command pool, descriptor pools, uniform ring slice and transient buffer and begins the command buffer
+void beginFrame(VulkanContext* context, VulkanFrame& frame);
+void addFrameWait(VulkanFrame& frame, VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value = 0);
+// signals the next graphics timeline value, and the binary release semaphore for presentation if asked to
+void submitFrame(VulkanContext* context, VulkanFrame& frame, bool signalRelease);
+// linear sub-allocation from the persistently mapped transient buffer, valid until the frame is begun again
+VkDeviceSize allocateTransient(VulkanContext* context, VulkanFrame& frame, VkDeviceSize size, VkDeviceSize alignment, void** mapped);
+VkDescriptorSet allocateTransientDescriptorSet(VulkanContext* context, VulkanFrame& frame, VkDescriptorSetLayout layout);
+
+void createDescriptorAllocator(VulkanContext* context, uint32_t setsPerPool, VulkanDescriptorAllocator& allocator);
+void destroyDescriptorAllocator(VulkanContext* context, VulkanDescriptorAllocator& allocator);
+void resetDescriptorAllocator(VulkanContext* context, VulkanDescriptorAllocator& allocator);
+VkDescriptorSet allocateDescriptorSet(VulkanContext* context, VulkanDescriptorAllocator& allocator, VkDescriptorSetLayout layout);
+
+// one persistently mapped buffer behind a single dynamic uniform descriptor, each frame in flight writes its own slice
+void createUniformRing(VulkanContext* context, VkDeviceSize frameSize);
+void destroyUniformRing(VulkanContext* context);
+void resetUniformRing(VulkanContext* context, uint32_t frameIndex);
+// copies the block into the ring and returns its dynamic offset, valid until the frame is begun again
+uint32_t pushUniforms(VulkanContext* context, VulkanFrame& frame, const void* data, VkDeviceSize size);
+VkDescriptorSetLayout getUniformRingLayout(VulkanContext* context);
+void bindUniformRing(VulkanContext* context, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t offset);
+
+// one update-after-bind set with every storage buffer (binding 0) and texture (binding 1), shaders pick them by index:
+//   layout(set = N, binding = 1) uniform sampler2D textures[];
+// so draws only push an index instead of binding a set each
+void createBindlessTable(VulkanContext* context, uint32_t maxTextures, uint32_t maxBuffers);
+void destroyBindlessTable(VulkanContext* context);
+uint32_t addBindlessTexture(VulkanContext* context, VkImageView imageView, VkSampler sampler);
+uint32_t addBindlessBuffer(VulkanContext* context, const VulkanBuffer& buffer);
+// the slot is handed out again once the frame retired
+void releaseBindlessTexture(VulkanContext* context, VulkanFrame& frame, uint32_t index);
+void releaseBindlessBuffer(VulkanContext* context, VulkanFrame& frame, uint32_t index);
+void retireBindlessSlots(VulkanContext* context, uint32_t frameIndex);
+VkDescriptorSetLayout getBindlessLayout(VulkanContext* context);
+void bindBindlessTable(VulkanContext* context, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set);
+
+// formats a vertex layout accepts, all mandatory for vertex buffers and whole words so every attribute stays 4 byte aligned
+constexpr uint32_t getVertexFormatSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_UINT:
+        case VK_FORMAT_R32_SFLOAT:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32_SFLOAT:
+            return 12;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+template<uint32_t Location, VkFormat Format>
+struct VulkanVertexAttribute {
+    static constexpr uint32_t location = Location;
+    static constexpr VkFormat format = Format;
+    static constexpr uint32_t size = getVertexFormatSize(Format);
+    static_assert(size > 0, "unsupported vertex attribute format");
+};
+
+// attributes packed back to back in declaration order, the cpu struct is checked against stride and offset<I>
+template<typename... Attributes>
+struct VulkanVertexLayout {
+    static constexpr uint32_t count = sizeof...(Attributes);
+    static constexpr uint32_t stride = (Attributes::size + ... + 0);
+
+    template<size_t I>
+    static constexpr uint32_t offset() {
+        constexpr uint32_t sizes[] = { Attributes::size... };
+        uint32_t offset {0};
+        for (size_t i {0}; i < I; i++) {
+            offset += sizes[i];
+        }
+        return offset;
+    }
+
+    static constexpr VkVertexInputBindingDescription getBindingDescription(uint32_t binding, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) {
+        return { binding, stride, inputRate };
+    }
 
-void allocateCommandBuffers(VulkanContext* context, VkCommandPool& commandPool, std::vector<VkCommandBuffer>& commandBuffer);
+    static constexpr std::array<VkVertexInputAttributeDescription, count> getAttributeDescription(uint32_t binding) {
+        constexpr uint32_t locations[] = { Attributes::location... };
+        constexpr VkFormat formats[] = { Attributes::format... };
+        constexpr uint32_t sizes[] = { Attributes::size... };
+        std::array<VkVertexInputAttributeDescription, count> attributeDescriptions {};
+        uint32_t offset {0};
+        for (size_t i {0}; i < count; i++) {
+            attributeDescriptions[i] = { locations[i], binding, formats[i], offset };
+            offset += sizes[i];
+        }
+        return attributeDescriptions;
+    }
+};
 
+// authoring format, meshes are built and bounded with full precision and packed on upload
 struct Vertex {
     glm::vec2 position;
     glm::vec3 color;
 
+    using Layout = VulkanVertexLayout<
+        VulkanVertexAttribute<0, VK_FORMAT_R32G32_SFLOAT>,
+        VulkanVertexAttribute<1, VK_FORMAT_R32G32B32_SFLOAT>>;
+
     static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription {};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return bindingDescription;
+        return Layout::getBindingDescription(0);
     }
 
-    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescription() {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+    static std::array<VkVertexInputAttributeDescription, Layout::count> getAttributeDescription() {
+        return Layout::getAttributeDescription(0);
+    }
+};
+static_assert(sizeof(Vertex) == Vertex::Layout::stride && offsetof(Vertex, color) == Vertex::Layout::offset<1>(), "Vertex doesn't match its layout");
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, position);
+// what the vertex buffers hold, 8 instead of 20 bytes: half float position and unorm8 color
+struct PackedVertex {
+    uint16_t position[2];
+    uint8_t color[4];
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
+    using Layout = VulkanVertexLayout<
+        VulkanVertexAttribute<0, VK_FORMAT_R16G16_SFLOAT>,
+        VulkanVertexAttribute<1, VK_FORMAT_R8G8B8A8_UNORM>>;
 
-        return attributeDescriptions;
+    static VkVertexInputBindingDescription getBindingDescription() {
+        return Layout::getBindingDescription(0);
+    }
+
+    static std::array<VkVertexInputAttributeDescription, Layout::count> getAttributeDescription() {
+        return Layout::getAttributeDescription(0);
+    }
+};
+static_assert(sizeof(PackedVertex) == PackedVertex::Layout::stride && offsetof(PackedVertex, color) == PackedVertex::Layout::offset<1>(), "PackedVertex doesn't match its layout");
+
+// batch conversions with sse2 (f16c for halves where the compiler targets it) and a scalar tail, round to nearest even
+void packHalf(const float* values, uint16_t* packed, size_t count);
+void packSnorm16(const float* values, int16_t* packed, size_t count);
+void packUnorm8(const float* values, uint8_t* packed, size_t count);
+// unit normals folded onto the octahedron, two snorm16 per normal for a VK_FORMAT_R16G16_SNORM attribute
+void packOctahedral(const glm::vec3* normals, int16_t* packed, size_t count);
+void packVertices(const Vertex* vertices, PackedVertex* packed, size_t count);
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices);
+uint32_t findMemoryType(VulkanContext* context, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+bool hasMemoryType(VulkanContext* context, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+void createBuffer(VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VulkanBuffer& buffer);
+void destroyBuffer(VulkanContext* context, VulkanBuffer& buffer);
+
+void createImage(VulkanContext* context, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VulkanImage& image);
+void createImage(VulkanContext* context, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VulkanImage& image);
+// render target that is only ever an attachment, lazily allocated where the device offers it
+// extra usage (e.g. sampled) makes it a regular image instead, single sampled depth that way can be stored and read back later
+void createAttachmentImage(VulkanContext* context, uint32_t width, uint32_t height, VkFormat format, VkSampleCountFlagBits samples, VulkanImage& image, VkImageUsageFlags usage = 0);
+bool isDepthFormat(VkFormat format);
+// first of D32, D32S8 and D24S8 that can be a depth attachment
+VkFormat chooseDepthFormat(VulkanContext* context);
+// highest supported count for color and depth attachments that doesn't exceed requested
+VkSampleCountFlagBits chooseSampleCount(VulkanContext* context, VkSampleCountFlagBits requested);
+void destroyImage(VulkanContext* context, VulkanImage& image);
+
+// per-instance attributes, bound at binding 1 with VK_VERTEX_INPUT_RATE_INSTANCE
+// left at full precision, the culling pass reads them as vec4s
+struct Instance {
+    glm::vec3 position;
+    float scale;
+
+    using Layout = VulkanVertexLayout<
+        VulkanVertexAttribute<2, VK_FORMAT_R32G32B32_SFLOAT>,
+        VulkanVertexAttribute<3, VK_FORMAT_R32_SFLOAT>>;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        return Layout::getBindingDescription(1, VK_VERTEX_INPUT_RATE_INSTANCE);
     }
+
+    static std::array<VkVertexInputAttributeDescription, Layout::count> getAttributeDescription() {
+        return Layout::getAttributeDescription(1);
+    }
+};
+static_assert(sizeof(Instance) == Instance::Layout::stride && offsetof(Instance, scale) == Instance::Layout::offset<1>(), "Instance doesn't match its layout");
+
+void createVertexBuffer(VulkanContext* context, const std::vector<Vertex>& vertices, VulkanBuffer& vertexBuffer);
+void destroyVertexBuffer(VulkanContext* context, VulkanBuffer& vertexBuffer);
+void createIndexBuffer(VulkanContext* context, const std::vector<uint32_t>& indices, VulkanBuffer& indexBuffer);
+void destroyIndexBuffer(VulkanContext* context, VulkanBuffer& indexBuffer);
+
+const uint32_t MAX_MESH_LODS = 4;
+
+// error is the simplification distance relative to the mesh radius, 0 for the full mesh
+struct VulkanMeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
 };
-void createVertexBuffer(VulkanContext* context, const std::vector<Vertex>& vertices, VkBuffer* vertexBuffer, VkDeviceMemory* vertexBufferMemory);
-void destroyVertexBuffer(VulkanContext* context, VkBuffer& vertexBuffer);
\ No newline at end of file
+
+// firstIndex and indexCount are the lod currently drawn, zero while a streamed mesh isn't resident yet
+struct VulkanMesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    // bounding sphere around the mesh origin, scaled by the instance for culling
+    float radius;
+    uint32_t lodCount;
+    std::array<VulkanMeshLod, MAX_MESH_LODS> lods;
+};
+
+// binary mesh file written by the mesh converter: this header, then PackedVertex data and uint32_t indices at the given
+// offsets, both ready to be copied into the arenas as they are. lod index ranges are relative to the mesh's indices
+const uint32_t MESH_FILE_MAGIC = 0x4853454d;
+const uint32_t MESH_FILE_VERSION = 1;
+struct VulkanMeshFileLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+};
+struct VulkanMeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    // sizeof(PackedVertex) when written, files for another vertex format are rejected
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    float radius;
+    uint32_t reserved;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    VulkanMeshFileLod lods[MAX_MESH_LODS];
+};
+static_assert(sizeof(VulkanMeshFileHeader) == 48 + 16 * MAX_MESH_LODS, "the mesh file header can't have padding");
+const uint64_t MESH_FILE_ALIGNMENT = 16;
+
+struct VulkanMeshLoad;
+// every mesh lives in one shared vertex and index arena, so a whole frame is drawn with a few indirect calls
+struct VulkanDrawList {
+    VulkanBuffer vertexArena;
+    uint32_t vertexCapacity;
+    uint32_t vertexCount;
+    VulkanBuffer indexArena;
+    uint32_t indexCapacity;
+    uint32_t indexCount;
+    std::vector<VulkanMesh> meshes;
+    // instances grouped by mesh, kept until clearInstances
+    std::vector<std::vector<Instance>> instances;
+    // written by prepareDrawList into the transient buffer of the current frame
+    VkBuffer frameBuffer;
+    VkDeviceSize instanceOffset;
+    VkDeviceSize commandOffset;
+    VkDeviceSize countOffset;
+    uint32_t instanceCount;
+    uint32_t commandCount;
+    // streamed meshes that aren't resident yet
+    std::vector<VulkanMeshLoad*> loads;
+};
+
+void createDrawList(VulkanContext* context, uint32_t maxVertices, uint32_t maxIndices, VulkanDrawList& drawList);
+void destroyDrawList(VulkanContext* context, VulkanDrawList& drawList);
+uint32_t addMesh(VulkanContext* context, VulkanDrawList& drawList, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+// adds an empty mesh right away and maps, validates and faults in the file on the thread pool
+// updateMeshStreaming copies it into the arenas once that finished, until then its instances draw nothing
+uint32_t requestMesh(VulkanContext* context, VulkanDrawList& drawList, const std::string& filename);
+// uploads finished loads until byteBudget is spent, call before beginFrame so the frame acquires them
+// returns the number of meshes that became resident, failed loads stay empty and are logged
+uint32_t updateMeshStreaming(VulkanContext* context, VulkanDrawList& drawList, VkDeviceSize byteBudget);
+// draws the coarsest lod whose error is at most maxError
+void selectMeshLod(VulkanDrawList& drawList, uint32_t mesh, float maxError);
+void addInstance(VulkanDrawList& drawList, uint32_t mesh, const Instance& instance);
+void clearInstances(VulkanDrawList& drawList);
+// front to back within each mesh, so depth testing rejects as much overdraw as possible early
+void sortInstances(VulkanDrawList& drawList, const glm::vec3& cameraPosition);
+// builds one indirect command per mesh (instanceCount = its instances), call before the render pass
+void prepareDrawList(VulkanContext* context, VulkanFrame& frame, VulkanDrawList& drawList);
+void recordDrawList(VulkanContext* context, VkCommandBuffer commandBuffer, const VulkanDrawList& drawList);
+
+// what the gpu sees of a scene entity, bound as a storage buffer indexed by entity
+struct VulkanSceneObject {
+    glm::mat4 world;
+    // world space bounding sphere, center in xyz and radius in w
+    glm::vec4 sphere;
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t padding[2];
+};
+static_assert(sizeof(VulkanSceneObject) == 96, "VulkanSceneObject has to match its std430 layout");
+const uint32_t SCENE_NO_PARENT = UINT32_MAX;
+
+// entities in structure of arrays, each attribute contiguous and indexed by entity
+// entities are only appended and parents have to exist before their children, so the arrays are always in hierarchy order
+struct VulkanScene {
+    uint32_t count;
+    uint32_t capacity;
+    std::vector<uint32_t> parents;
+    // local transform, the rotation is a unit quaternion and the scale uniform so bounding spheres stay spheres
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+    std::vector<float> rotationW;
+    std::vector<float> scales;
+    // local bounding sphere
+    std::vector<float> boundsX;
+    std::vector<float> boundsY;
+    std::vector<float> boundsZ;
+    std::vector<float> boundsRadius;
+    std::vector<uint32_t> meshes;
+    std::vector<uint32_t> materials;
+    // written by updateScene
+    std::vector<glm::mat4> worlds;
+    std::vector<float> worldScales;
+    std::vector<glm::vec4> worldSpheres;
+    // set by the setters, updateScene extends it to whole subtrees and clears it again
+    std::vector<uint8_t> dirty;
+    uint32_t firstDirty;
+    std::vector<uint32_t> updated;
+    // one host visible copy per frame in flight, each one only gets the objects that changed since it was last written
+    std::array<VulkanBuffer, MAX_FRAMES_IN_FLIGHT> objectBuffers;
+    std::array<std::vector<uint32_t>, MAX_FRAMES_IN_FLIGHT> pendingObjects;
+    // a bit per frame in flight whose buffer is missing the latest state of the entity
+    std::vector<uint8_t> pendingFrames;
+};
+
+void createScene(VulkanContext* context, uint32_t capacity, VulkanScene& scene);
+void destroyScene(VulkanContext* context, VulkanScene& scene);
+// parent is SCENE_NO_PARENT or an existing entity, bounds is the local bounding sphere (center in xyz, radius in w)
+// entities with mesh UINT32_MAX only carry a transform for their children
+uint32_t addEntity(VulkanScene& scene, uint32_t parent, uint32_t mesh, uint32_t material, const glm::vec4& bounds);
+// rotation is a unit quaternion as (x, y, z, w)
+void setEntityTransform(VulkanScene& scene, uint32_t entity, const glm::vec3& position, const glm::vec4& rotation, float scale);
+void setEntityPosition(VulkanScene& scene, uint32_t entity, const glm::vec3& position);
+void setEntityMesh(VulkanScene& scene, uint32_t entity, uint32_t mesh, uint32_t material);
+// recomputes world matrices and bounds of the dirty entities and everything below them, returns how many were recomputed
+uint32_t updateScene(VulkanScene& scene);
+// copies the objects the frame's buffer is missing into it, call after waitFrame so the gpu is done reading it
+// returns the number of objects written
+uint32_t writeSceneObjects(VulkanScene& scene, const VulkanFrame& frame);
+// feeds the instanced pipelines, which only take a position and scale per instance, with every entity that has a mesh
+void addSceneInstances(const VulkanScene& scene, VulkanDrawList& drawList);
+
+const VkDeviceSize TEXTURE_STREAM_FRAME_BUDGET = 16ull * 1024 * 1024;
+struct VulkanTextureStats {
+    uint32_t textureCount;
+    uint32_t residentMips;
+    VkDeviceSize residentBytes;
+    VkDeviceSize budget;
+    uint64_t streamedBytes;
+    uint32_t evictedMips;
+};
+
+// ktx2 textures kept in their stored format (bc, astc or rgba8 without supercompression), streamed in coarsest mip first
+// against a memory budget, when it runs out the least recently used textures give up their finest mips
+// a budget of 0 takes half of the largest device local heap
+void createTextureStreamer(VulkanContext* context, VkDeviceSize budget);
+void destroyTextureStreamer(VulkanContext* context);
+void setTextureBudget(VulkanContext* context, VkDeviceSize budget);
+// returns right away, the file is mapped, validated and faulted in coarse to fine on the thread pool
+uint32_t loadTexture(VulkanContext* context, const std::string& filename);
+void unloadTexture(VulkanContext* context, VulkanFrame& frame, uint32_t texture);
+// marks the texture as used this frame, finestMip is the sharpest level it needs, 0 for full resolution
+void touchTexture(VulkanContext* context, uint32_t texture, uint32_t finestMip = 0);
+// uploads mips that finished reading and evicts to make room for them until byteBudget is spent, call before beginFrame
+// returns the number of textures that changed
+uint32_t updateTextureStreaming(VulkanContext* context, VulkanFrame& frame, VkDeviceSize byteBudget);
+// both change whenever mips stream in or get evicted, so look them up every frame
+// VK_NULL_HANDLE and UINT32_MAX until the first mips are resident, the index also stays UINT32_MAX without a bindless table
+VkImageView getTextureView(VulkanContext* context, uint32_t texture);
+uint32_t getTextureIndex(VulkanContext* context, uint32_t texture);
+VkSampler getTextureSampler(VulkanContext* context);
+void getTextureStats(VulkanContext* context, VulkanTextureStats& stats);
+
+// max depth pyramid sampled by the culling pass, built from the depth buffer of the previous frame
+struct VulkanHiZ {
+    VulkanImage image;
+    std::vector<VkImageView> mipViews;
+    uint32_t depthWidth;
+    uint32_t depthHeight;
+    bool valid;
+};
+// gpu frustum and occlusion culling of a draw list, the output is consumed by recordCulledDrawList
+struct VulkanCuller {
+    bool supported;
+    // compacts visible objects with an atomic counter, needs drawIndirectCount
+    bool compact;
+    uint32_t maxObjects;
+    VkDescriptorSetLayout cullSetLayout;
+    VulkanPipeline cullPipeline;
+    VkDescriptorSetLayout hiZSetLayout;
+    VulkanPipeline hiZPipeline;
+    VkSampler sampler;
+    VulkanImage emptyHiZ;
+    std::array<VulkanBuffer, MAX_FRAMES_IN_FLIGHT> commands;
+    std::array<VulkanBuffer, MAX_FRAMES_IN_FLIGHT> visibleInstances;
+    std::array<VulkanBuffer, MAX_FRAMES_IN_FLIGHT> drawCount;
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> objectCount;
+};
+struct VulkanCullView {
+    glm::mat4 viewProjection;
+    // projection[0][0] and projection[1][1], turns a view space radius into an ndc extent
+    glm::vec2 projectionScale;
+    glm::vec3 cameraPosition;
+    // nullptr disables the occlusion test
+    const VulkanHiZ* hiZ;
+};
+
+void createCuller(VulkanContext* context, uint32_t maxObjects, VulkanCuller& culler);
+void destroyCuller(VulkanContext* context, VulkanCuller& culler);
+void createHiZ(VulkanContext* context, uint32_t depthWidth, uint32_t depthHeight, VulkanHiZ& hiZ);
+void destroyHiZ(VulkanContext* context, VulkanHiZ& hiZ);
+void buildHiZ(VulkanContext* context, VulkanFrame& frame, const VulkanCuller& culler, VulkanHiZ& hiZ, VkImageView depthView);
+// records the culling dispatch into the frame command buffer before the render pass, returns false if unsupported
+bool cullDrawList(VulkanContext* context, VulkanFrame& frame, VulkanCuller& culler, VulkanDrawList& drawList, const VulkanCullView& view);
+void recordCulledDrawList(VulkanContext* context, VkCommandBuffer commandBuffer, uint32_t frameIndex, const VulkanCuller& culler, const VulkanDrawList& drawList);
+
+// median and tail of the last few hundred samples of a scope, in milliseconds
+struct VulkanScopeStatistics {
+    std::string name;
+    bool gpu;
+    uint32_t samples;
+    double median;
+    double p95;
+    double p99;
+};
+
+// of an ascending, non-empty sample vector, the benchmark report uses the same definition for its frame times
+double percentile(const std::vector<double>& sorted, double p);
+void createProfiler(VulkanContext* context);
+void destroyProfiler(VulkanContext* context);
+// called by beginFrame and submitFrame, they wrap the whole command buffer in a "frame" scope
+void beginProfilerFrame(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer);
+void endProfilerFrame(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer);
+// timestamp pair in the frame command buffer, names have to outlive the frame (string literals)
+uint32_t beginGpuScope(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const char* name);
+void endGpuScope(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, uint32_t scope);
+// reads the timestamps of a retired frame, returns its gpu time in milliseconds or a negative value if there was none
+double collectProfilerFrame(VulkanContext* context, uint32_t frameIndex);
+// cpu scopes nest like a stack and belong to the thread recording frames
+void beginCpuScope(VulkanContext* context, const char* name);
+void endCpuScope(VulkanContext* context);
+// keeps every scope from now on until the trace is written as chrome trace json
+void startProfilerTrace(VulkanContext* context);
+bool writeProfilerTrace(VulkanContext* context, const std::string& filename);
+std::vector<VulkanScopeStatistics> getProfilerStatistics(VulkanContext* context);
+void logProfilerSummary(VulkanContext* context);
+
+typedef uint32_t VulkanGraphResource;
+enum VulkanGraphAccess {
+    GRAPH_ACCESS_COLOR_ATTACHMENT,
+    // single sampled target the multisampled color attachment of the same pass resolves into
+    GRAPH_ACCESS_COLOR_RESOLVE,
+    GRAPH_ACCESS_DEPTH_ATTACHMENT,
+    // depth test without writes, the image can be sampled in the same pass
+    GRAPH_ACCESS_DEPTH_READ,
+    GRAPH_ACCESS_SAMPLED,
+    GRAPH_ACCESS_STORAGE_READ,
+    GRAPH_ACCESS_STORAGE_WRITE,
+    GRAPH_ACCESS_TRANSFER_SRC,
+    GRAPH_ACCESS_TRANSFER_DST
+};
+struct VulkanGraphUse {
+    VulkanGraphResource resource;
+    VulkanGraphAccess access;
+};
+struct VulkanGraphPass {
+    const char* name;
+    std::vector<VulkanGraphUse> uses;
+    // with a record callback the pass renders into its attachment uses through recordRendering
+    uint32_t drawCount;
+    VulkanRecordCallback record;
+    // otherwise compute or transfer work goes straight into the frame command buffer
+    std::function<void(VkCommandBuffer commandBuffer)> execute;
+    // kept even if nothing reads what it writes
+    bool sideEffects;
+};
+
+// passes are declared again every frame, the transient images behind them are only recreated when their descriptions change
+void createRenderGraph(VulkanContext* context, VulkanRenderGraph*& graph);
+void destroyRenderGraph(VulkanContext* context, VulkanRenderGraph*& graph);
+void resetRenderGraph(VulkanRenderGraph* graph);
+// imported images count as graph outputs, initialStages is where their first use has to wait (e.g. for the acquire semaphore)
+VulkanGraphResource importGraphImage(VulkanRenderGraph* graph, const char* name, VkImage image, VkImageView imageView, VkFormat format, uint32_t width, uint32_t height,
+    VkImageLayout initialLayout, VkPipelineStageFlags2 initialStages, VkImageLayout finalLayout, VkClearValue clearValue = {});
+// transient images only live for the frame and share memory with others whose passes don't overlap
+VulkanGraphResource createGraphImage(VulkanRenderGraph* graph, const char* name, uint32_t width, uint32_t height, VkFormat format, VkClearValue clearValue = {},
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+void addGraphPass(VulkanRenderGraph* graph, VulkanGraphPass pass);
+// only valid while the graph executes, i.e. from inside pass callbacks
+VkImageView getGraphImageView(const VulkanRenderGraph* graph, VulkanGraphResource resource);
+// culls passes that don't reach an imported image, then records the rest with batched barriers in declaration order
+void executeRenderGraph(VulkanContext* context, VulkanRenderGraph* graph, VulkanFrame& frame);
\ No newline at end of file
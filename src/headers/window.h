@@ -1,7 +1,6 @@
 #pragma once
 #include <string_view>
-#include <glfw/glfw3.h>
-#include <GLFW/glfw3native.h>
+#include <GLFW/glfw3.h>
 #include "vulkan-base.h"
 #include "input.h"
 
@@ -12,25 +11,39 @@ private:
     VulkanContext* context;
     VkSurfaceKHR surface;
     VulkanSwapchain swapchain;
+    // VK_NULL_HANDLE and no framebuffers when rendering dynamically
     VkRenderPass renderPass;
     std::vector<VkFramebuffer> framebuffers;
-    VulkanPipeline pipeline;
-    VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffer;
-    std::vector<VkFence> fence;
-    std::vector<VkSemaphore> acquireSemaphore;
-    std::vector<VkSemaphore> releaseSemaphore;
+    bool dynamicRendering {false};
+    // frame passes when rendering dynamically
+    VulkanRenderGraph* renderGraph {nullptr};
+    VulkanPipelineDescription pipelineDescription;
+    // depth only pass in front of the main pass, which then shades each pixel once with an equal depth test
+    bool depthPrepass;
+    VulkanPipelineDescription prepassDescription;
+    VkSampleCountFlagBits samples;
+    VkFormat depthFormat {VK_FORMAT_UNDEFINED};
+    // render pass attachments, the render graph keeps its own transient ones
+    VulkanImage depthImage {};
+    VulkanImage colorImage {};
+    std::array<VulkanFrame, MAX_FRAMES_IN_FLIGHT> frames;
+    uint32_t frameIndex {0};
+    VulkanPresentPolicy presentPolicy;
+    double frameStartTime {.0};
+    double latencySum {.0};
+    uint32_t latencySamples {0};
 
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    VulkanBuffer vertexBuffer;
 
 public:
     uint16_t width;
     uint16_t height;
     bool framebufferResized {false};
 
-    Window(const uint16_t width, const uint16_t height, const std::string_view title);
+    Window(const uint16_t width, const uint16_t height, const std::string_view title, VulkanPresentPolicy presentPolicy = PRESENT_POLICY_LOW_LATENCY,
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_4_BIT, bool depthPrepass = true);
     void setupVulkan();
+    void createAttachments();
     void run();
     void render();
     void clean();
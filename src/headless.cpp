@@ -0,0 +1,364 @@
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "headless.h"
+
+Headless::Headless(const uint16_t width, const uint16_t height, bool useDynamicRendering) : width(width), height(height) {
+    setupVulkan(useDynamicRendering);
+
+    const std::vector<Vertex> vertices = {
+        {{0.0f, -0.5f}, {1.0f, 1.0f, 1.0f}},
+        {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+        {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+    };
+
+    createVertexBuffer(context, vertices, vertexBuffer);
+
+    const std::vector<Vertex> quadVertices = {
+        {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+        {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
+        {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
+        {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+    };
+
+    // room for meshes streamed in with loadMeshes
+    createDrawList(context, 1 << 20, 1 << 22, drawList);
+    addMesh(context, drawList, vertices, { 0, 1, 2 });
+    addMesh(context, drawList, quadVertices, { 0, 1, 2, 2, 3, 0 });
+}
+
+void Headless::setDraws(uint32_t count, bool useIndirect, bool useCulling, bool useOcclusion) {
+    draws = count;
+    indirect = useIndirect || useCulling;
+    culling = useCulling;
+
+    if (culling && culler.maxObjects < count) {
+        // frames still in flight keep using the old buffers until they retired
+        VulkanCuller retired = culler;
+        VulkanContext* context = this->context;
+        deferDeletion(context, [context, retired]() mutable {
+            destroyCuller(context, retired);
+        });
+        createCuller(context, count, culler);
+        if (!culler.supported) {
+            culling = false;
+        }
+    }
+
+    // D32 is always sampleable but not necessarily a depth attachment
+    VkFormatProperties depthProperties;
+    vkGetPhysicalDeviceFormatProperties(context->physicalDevice, occlusionPipelineDescription.depthFormat, &depthProperties);
+    bool depthSupported = depthProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    occlusion = culling && useOcclusion && dynamicRendering && depthSupported;
+    if (useOcclusion && !occlusion) {
+        LOG(LOG_DEFAULT_UTILS, false, "occlusion culling needs gpu culling, dynamic rendering and a D32 depth attachment, drawing without it");
+    }
+    if (occlusion && depth.image == VK_NULL_HANDLE) {
+        createAttachmentImage(context, width, height, occlusionPipelineDescription.depthFormat, VK_SAMPLE_COUNT_1_BIT, depth, VK_IMAGE_USAGE_SAMPLED_BIT);
+        createHiZ(context, width, height, hiZ);
+        requestPipeline(context, occlusionPipelineDescription);
+    }
+
+    clearInstances(drawList);
+    if (!indirect) {
+        return;
+    }
+    uint32_t columns = std::max(1u, (uint32_t)std::ceil(std::sqrt((double)count)));
+    float cellSize = 2.0f / columns;
+    for (uint32_t i {0}; i < count; i++) {
+        Instance instance;
+        instance.position = { -1.0f + cellSize * (i % columns + 0.5f), -1.0f + cellSize * (i / columns + 0.5f), 0.0f };
+        instance.scale = cellSize;
+        addInstance(drawList, i % drawList.meshes.size(), instance);
+    }
+}
+
+double Headless::loadMeshes(const std::vector<std::string>& filenames) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto& filename : filenames) {
+        requestMesh(context, drawList, filename);
+    }
+    while (!drawList.loads.empty()) {
+        if (updateMeshStreaming(context, drawList, ~0ull) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    waitUploads(context);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Headless::loadTextures(const std::vector<std::string>& filenames, VkDeviceSize budget) {
+    if (budget > 0) {
+        setTextureBudget(context, budget);
+    }
+    for (auto& filename : filenames) {
+        textures.push_back(loadTexture(context, filename));
+    }
+}
+
+VulkanTextureStats Headless::textureStats() {
+    VulkanTextureStats stats;
+    getTextureStats(context, stats);
+    return stats;
+}
+
+void Headless::setScene(uint32_t objects, float moving) {
+    if (scene.capacity > 0) {
+        // frames still in flight keep reading the old object buffers until they retired
+        VulkanScene retired = scene;
+        VulkanContext* context = this->context;
+        deferDeletion(context, [context, retired]() mutable {
+            destroyScene(context, retired);
+        });
+    }
+    createScene(context, objects, scene);
+    movingEntities.clear();
+
+    uint32_t roots = (objects + 15) / 16;
+    uint32_t columns = std::max(1u, (uint32_t)std::ceil(std::sqrt((double)roots)));
+    float cellSize = 2.0f / columns;
+    const glm::vec4 identity(0.0f, 0.0f, 0.0f, 1.0f);
+    const glm::vec4 bounds(0.0f, 0.0f, 0.0f, 0.5f);
+    for (uint32_t root {0}; root < roots && scene.count < objects; root++) {
+        uint32_t rootEntity = addEntity(scene, SCENE_NO_PARENT, root % drawList.meshes.size(), 0, bounds);
+        setEntityTransform(scene, rootEntity, { -1.0f + cellSize * (root % columns + 0.5f), -1.0f + cellSize * (root / columns + 0.5f), 0.0f }, identity, cellSize * 0.5f);
+        if (root < (uint32_t)(moving * roots)) {
+            movingEntities.push_back(rootEntity);
+        }
+        for (uint32_t child {0}; child < 3 && scene.count < objects; child++) {
+            uint32_t childEntity = addEntity(scene, rootEntity, child % drawList.meshes.size(), 0, bounds);
+            setEntityTransform(scene, childEntity, { 0.6f * (child - 1.0f), 0.4f, 0.0f }, identity, 0.4f);
+            for (uint32_t leaf {0}; leaf < 4 && scene.count < objects; leaf++) {
+                uint32_t leafEntity = addEntity(scene, childEntity, leaf % drawList.meshes.size(), 0, bounds);
+                setEntityTransform(scene, leafEntity, { 0.5f * (leaf - 1.5f), 0.5f, 0.0f }, identity, 0.3f);
+            }
+        }
+    }
+    updateScene(scene);
+}
+
+void Headless::setupVulkan(bool useDynamicRendering) {
+    initVulkan(context, true);
+
+    createImage(context, width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, target);
+    dynamicRendering = useDynamicRendering && context->features.dynamicRendering;
+    if (dynamicRendering) {
+        renderPass = VK_NULL_HANDLE;
+        pipelineDescription = defaultPipelineDescription("spvs/default-vert.spv", "spvs/default-frag.spv", target.format);
+        instancedPipelineDescription = defaultPipelineDescription("spvs/instanced-vert.spv", "spvs/default-frag.spv", target.format);
+    } else {
+        createRenderPass(context, target.format, renderPass, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        createFramebuffers(context, { target.imageView }, target.width, target.height, renderPass, framebuffers);
+        pipelineDescription = defaultPipelineDescription("spvs/default-vert.spv", "spvs/default-frag.spv", renderPass);
+        instancedPipelineDescription = defaultPipelineDescription("spvs/instanced-vert.spv", "spvs/default-frag.spv", renderPass);
+    }
+    // reflection can't tell the per instance binding apart, so the instanced layout is spelled out
+    instancedPipelineDescription.bindings = { PackedVertex::getBindingDescription(), Instance::getBindingDescription() };
+    auto vertexAttributes = PackedVertex::getAttributeDescription();
+    auto instanceAttributes = Instance::getAttributeDescription();
+    instancedPipelineDescription.attributes.assign(vertexAttributes.begin(), vertexAttributes.end());
+    instancedPipelineDescription.attributes.insert(instancedPipelineDescription.attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+    occlusionPipelineDescription = instancedPipelineDescription;
+    occlusionPipelineDescription.depthFormat = VK_FORMAT_D32_SFLOAT;
+    occlusionPipelineDescription.depthTest = true;
+    occlusionPipelineDescription.depthWrite = true;
+    requestPipeline(context, pipelineDescription);
+    requestPipeline(context, instancedPipelineDescription);
+    waitPipelines(context);
+    pipelineCacheStats = context->pipelineCacheStats;
+    createFrames(context, frames);
+}
+
+void Headless::collectGpuTiming(const VulkanFrame& frame) {
+    if (frame.gpuMilliseconds >= .0) {
+        gpuFrameTimes.push_back(frame.gpuMilliseconds);
+    }
+}
+
+void Headless::render() {
+    VulkanFrame& frame = frames[frameIndex];
+
+    beginCpuScope(context, "frame");
+    waitFrame(context, frame);
+    collectGpuTiming(frame);
+    updateMeshStreaming(context, drawList, MESH_STREAM_FRAME_BUDGET);
+    // nothing samples them yet, touching every one each frame streams them all in at full resolution
+    for (uint32_t texture : textures) {
+        touchTexture(context, texture);
+    }
+    updateTextureStreaming(context, frame, TEXTURE_STREAM_FRAME_BUDGET);
+
+    if (scene.capacity > 0) {
+        beginCpuScope(context, "scene");
+        // a quarter turn around z over 256 frames
+        float angle = 0.5f * (sceneFrame++ % 256) / 256.0f * 1.5707964f;
+        for (uint32_t entity : movingEntities) {
+            setEntityTransform(scene, entity, { scene.positionX[entity], scene.positionY[entity], scene.positionZ[entity] },
+                { 0.0f, 0.0f, std::sin(angle), std::cos(angle) }, scene.scales[entity]);
+        }
+        updateScene(scene);
+        writeSceneObjects(scene, frame);
+        endCpuScope(context);
+    }
+
+    beginFrame(context, frame);
+    {
+        VkClearValue clearValue = {1.0f, 0.0f, 1.0f, 1.0f};
+        VkRect2D renderArea = { {0, 0}, {target.width, target.height}};
+
+        if (culling) {
+            // the grid fills clip space exactly and lies in a single plane, so this measures the cost of the passes rather than their savings
+            VulkanCullView view;
+            view.viewProjection = glm::mat4(1.0f);
+            view.projectionScale = glm::vec2(1.0f, 1.0f);
+            view.cameraPosition = glm::vec3(0.0f, 0.0f, -1.0f);
+            view.hiZ = occlusion ? &hiZ : nullptr;
+            cullDrawList(context, frame, culler, drawList, view);
+        } else if (indirect) {
+            prepareDrawList(context, frame, drawList);
+        }
+
+        // the frame only clears until the pipeline finished compiling in the background
+        const VulkanPipeline* pipeline = requestPipeline(context, occlusion ? occlusionPipelineDescription : indirect ? instancedPipelineDescription : pipelineDescription);
+        uint32_t recordedDraws = indirect ? 1 : draws;
+        auto draw = [&](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline);
+
+            VkViewport viewport;
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = width;
+            viewport.height = height;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+            VkRect2D scissor;
+            scissor.offset = {0, 0};
+            scissor.extent = {width, height};
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+            if (culling) {
+                recordCulledDrawList(context, commandBuffer, frameIndex, culler, drawList);
+                return;
+            }
+            if (indirect) {
+                recordDrawList(context, commandBuffer, drawList);
+                return;
+            }
+
+            VkBuffer vertexBuffers[] = {vertexBuffer.buffer};
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+            for (uint32_t i {firstDraw}; i < firstDraw + drawCount; i++) {
+                vkCmdDraw(commandBuffer, static_cast<uint32_t>(3), 1, 0, 0);
+            }
+        };
+
+        if (dynamicRendering) {
+            // the previous frame read the target as a copy source, nothing is kept from it
+            transitionImage(frame.commandBuffer, target.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+            VkRenderingAttachmentInfo colorAttachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+            colorAttachment.imageView = target.imageView;
+            colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            colorAttachment.clearValue = clearValue;
+
+            VkRenderingAttachmentInfo depthAttachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+            if (occlusion) {
+                // the previous frame's pyramid was built from it, that read has to finish before the clear
+                transitionImage(frame.commandBuffer, depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+                    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+                depthAttachment.imageView = depth.imageView;
+                depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+                depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+                depthAttachment.clearValue.depthStencil = {1.0f, 0};
+            }
+
+            VkRenderingInfo renderingInfo = { VK_STRUCTURE_TYPE_RENDERING_INFO };
+            renderingInfo.renderArea = renderArea;
+            renderingInfo.layerCount = 1;
+            renderingInfo.colorAttachmentCount = 1;
+            renderingInfo.pColorAttachments = &colorAttachment;
+            renderingInfo.pDepthAttachment = occlusion ? &depthAttachment : nullptr;
+            recordRendering(context, frameIndex, frame.commandBuffer, renderingInfo, target.format, occlusion ? depth.format : VK_FORMAT_UNDEFINED, VK_SAMPLE_COUNT_1_BIT,
+                pipeline ? recordedDraws : 0, draw);
+
+            transitionImage(frame.commandBuffer, target.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+            if (occlusion) {
+                transitionImage(frame.commandBuffer, depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+                buildHiZ(context, frame, culler, hiZ, depth.imageView);
+            }
+        } else {
+            VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+            beginInfo.renderPass = renderPass;
+            beginInfo.framebuffer = framebuffers[0];
+            beginInfo.renderArea = renderArea;
+            beginInfo.clearValueCount = 1;
+            beginInfo.pClearValues = &clearValue;
+            recordRenderPass(context, frameIndex, frame.commandBuffer, beginInfo, pipeline ? recordedDraws : 0, draw);
+        }
+    }
+    submitFrame(context, frame, false);
+    endCpuScope(context);
+
+    frameIndex = (frameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void Headless::finish() {
+    vkDeviceWaitIdle(context->device);
+    for (uint32_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VulkanFrame& frame = frames[(frameIndex + i) % MAX_FRAMES_IN_FLIGHT];
+        frame.gpuMilliseconds = collectProfilerFrame(context, frame.index);
+        collectGpuTiming(frame);
+    }
+}
+
+void Headless::startTrace() {
+    startProfilerTrace(context);
+}
+
+bool Headless::writeTrace(const std::string& filename) {
+    return writeProfilerTrace(context, filename);
+}
+
+std::vector<VulkanScopeStatistics> Headless::scopeStatistics() {
+    return getProfilerStatistics(context);
+}
+
+void Headless::clean() {
+    vkDeviceWaitIdle(context->device);
+
+    destroyVertexBuffer(context, vertexBuffer);
+    if (depth.image != VK_NULL_HANDLE) {
+        destroyHiZ(context, hiZ);
+        destroyImage(context, depth);
+    }
+    destroyCuller(context, culler);
+    destroyDrawList(context, drawList);
+    if (scene.capacity > 0) {
+        destroyScene(context, scene);
+    }
+
+    destroyFramebuffers(context, framebuffers);
+    destroyImage(context, target);
+
+    if (renderPass != VK_NULL_HANDLE) {
+        destroyRenderpass(context, renderPass);
+    }
+
+    destroyFrames(context, frames);
+
+    cleanVulkan(context);
+}
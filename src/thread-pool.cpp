@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <memory>
+#include "thread-pool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    threadCount = std::max(1u, threadCount);
+    for (uint32_t i {0}; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void(uint32_t)> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsDone.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& job) {
+    struct ParallelState {
+        std::function<void(uint32_t, uint32_t)> job;
+        std::atomic<uint32_t> next {0};
+        uint32_t count;
+        uint32_t finished {0};
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    // helpers that start after everything was claimed still touch the state, so it is shared rather than on the stack
+    auto state = std::make_shared<ParallelState>();
+    state->job = job;
+    state->count = count;
+
+    auto run = [state](uint32_t workerIndex) {
+        uint32_t completed {0};
+        for (uint32_t index = state->next++; index < state->count; index = state->next++) {
+            state->job(index, workerIndex);
+            completed++;
+        }
+        if (completed > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->finished += completed;
+            if (state->finished == state->count) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    uint32_t helpers = std::min(count > 0 ? count - 1 : 0, size());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i {0}; i < helpers; i++) {
+            jobs.push_front(run);
+        }
+    }
+    for (uint32_t i {0}; i < helpers; i++) {
+        jobAvailable.notify_one();
+    }
+
+    run(size());
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&] { return state->finished == state->count; });
+}
+
+void ThreadPool::work(uint32_t workerIndex) {
+    while (true) {
+        std::function<void(uint32_t)> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            activeJobs++;
+        }
+
+        job(workerIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeJobs--;
+            if (jobs.empty() && activeJobs == 0) {
+                jobsDone.notify_all();
+            }
+        }
+    }
+}
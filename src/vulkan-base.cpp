@@ -1,4 +1,7 @@
+#include <thread>
+#include <algorithm>
 #include "vulkan-base.h"
+#include "thread-pool.h"
 
 void dumpValidationLayers() {
     uint32_t layerPropertyCount;
@@ -47,7 +50,52 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
     }
 }
 
-VkDebugUtilsMessengerEXT debugMessenger;
+VkDebugUtilsMessengerEXT debugMessenger {VK_NULL_HANDLE};
+
+bool isInstanceLayerAvailable(const char* layerName) {
+    uint32_t layerPropertyCount;
+    VAC(vkEnumerateInstanceLayerProperties(&layerPropertyCount, 0));
+    std::vector<VkLayerProperties> layerProperties;
+    layerProperties.resize(layerPropertyCount);
+    VAC(vkEnumerateInstanceLayerProperties(&layerPropertyCount, layerProperties.data()));
+
+    for (auto& layerProperty : layerProperties) {
+        if (strcmp(layerProperty.layerName, layerName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isInstanceExtensionAvailable(const char* extensionName) {
+    uint32_t instanceExtensionCount;
+    VAC(vkEnumerateInstanceExtensionProperties(0, &instanceExtensionCount, 0));
+    std::vector<VkExtensionProperties> instanceExtensionProperties;
+    instanceExtensionProperties.resize(instanceExtensionCount);
+    VAC(vkEnumerateInstanceExtensionProperties(0, &instanceExtensionCount, instanceExtensionProperties.data()));
+
+    for (auto& extensionProperty : instanceExtensionProperties) {
+        if (strcmp(extensionProperty.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isDeviceExtensionAvailable(VkPhysicalDevice physicalDevice, const char* extensionName) {
+    uint32_t deviceExtensionCount;
+    VAC(vkEnumerateDeviceExtensionProperties(physicalDevice, 0, &deviceExtensionCount, 0));
+    std::vector<VkExtensionProperties> deviceExtensionProperties;
+    deviceExtensionProperties.resize(deviceExtensionCount);
+    VAC(vkEnumerateDeviceExtensionProperties(physicalDevice, 0, &deviceExtensionCount, deviceExtensionProperties.data()));
+
+    for (auto& extensionProperty : deviceExtensionProperties) {
+        if (strcmp(extensionProperty.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
 
 void populateCustomDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
     createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -66,19 +114,28 @@ bool initVulkanInstance(VulkanContext* context) {
     // dumpValidationLayers();
     // dumpInstanceExtensions();
 
-    std::vector<const char*> enabledLayers = {
-        "VK_LAYER_KHRONOS_validation"
-        // "VK_LAYER_LUNARG_monitor"
-    };
-    
-    uint32_t glfwInstanceExtensionCount;
-    const char** glfwInstanceExtensions = glfwGetRequiredInstanceExtensions(&glfwInstanceExtensionCount);
-    std::vector<const char*> enabledExtensions (glfwInstanceExtensions, glfwInstanceExtensions + glfwInstanceExtensionCount);
+    std::vector<const char*> enabledLayers;
+    // headless runs (e.g. ci on lavapipe) usually come without the sdk layers installed
+    if (!context->headless || isInstanceLayerAvailable("VK_LAYER_KHRONOS_validation")) {
+        enabledLayers.push_back("VK_LAYER_KHRONOS_validation");
+        // enabledLayers.push_back("VK_LAYER_LUNARG_monitor");
+    }
+
+    std::vector<const char*> enabledExtensions;
+    if (!context->headless) {
+        uint32_t glfwInstanceExtensionCount;
+        const char** glfwInstanceExtensions = glfwGetRequiredInstanceExtensions(&glfwInstanceExtensionCount);
+        enabledExtensions.assign(glfwInstanceExtensions, glfwInstanceExtensions + glfwInstanceExtensionCount);
 
-    for (size_t i {0}; i < glfwInstanceExtensionCount; i++) {
-        LOG(LOG_DEFAULT_UTILS, false, "glfw-extension-name: %s", glfwInstanceExtensions[i]);
+        for (size_t i {0}; i < glfwInstanceExtensionCount; i++) {
+            LOG(LOG_DEFAULT_UTILS, false, "glfw-extension-name: %s", glfwInstanceExtensions[i]);
+        }
+    }
+
+    bool debugUtils = !context->headless || isInstanceExtensionAvailable(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    if (debugUtils) {
+        enabledExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
-    enabledExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
     VkApplicationInfo applicationInfo = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
     applicationInfo.pApplicationName = "vulkan engine";
@@ -94,11 +151,15 @@ bool initVulkanInstance(VulkanContext* context) {
 
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo = {};
     populateCustomDebugMessengerCreateInfo(debugCreateInfo);
-    createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+    if (debugUtils) {
+        createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+    }
 
     VAC(vkCreateInstance(&createInfo, 0, &context->instance));
 
-    createCustomDebugMessenger(context);
+    if (debugUtils) {
+        createCustomDebugMessenger(context);
+    }
 
     return true;
 }
@@ -122,9 +183,22 @@ bool selectPhysicalDevice(VulkanContext* context) {
     }
 
     context->physicalDevice = physicalDevices[0];
+    vkGetPhysicalDeviceProperties(context->physicalDevice, &context->physicalDeviceProperties);
     return true;
 }
 
+const uint32_t QUEUE_FAMILY_NONE = ~0u;
+
+uint32_t findQueueFamily(const std::vector<VkQueueFamilyProperties>& queueFamilies, VkQueueFlags required, VkQueueFlags excluded) {
+    for (size_t i {0}; i < queueFamilies.size(); i++) {
+        VkQueueFamilyProperties queueFamily = queueFamilies[i];
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & required) == required && !(queueFamily.queueFlags & excluded)) {
+            return (uint32_t)i;
+        }
+    }
+    return QUEUE_FAMILY_NONE;
+}
+
 bool createLogicalDevice(VulkanContext* context) {
     uint32_t numQueueFamilies = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(context->physicalDevice, &numQueueFamilies, 0);
@@ -132,45 +206,170 @@ bool createLogicalDevice(VulkanContext* context) {
     queueFamilies.resize(numQueueFamilies);
     vkGetPhysicalDeviceQueueFamilyProperties(context->physicalDevice, &numQueueFamilies, queueFamilies.data());
 
-    uint32_t graphicsQueueIndex {0};
-    for (size_t i {0}; i < queueFamilies.size(); i++) {
-        VkQueueFamilyProperties queueFamily = queueFamilies[i];
-        if (queueFamily.queueCount > 0) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                graphicsQueueIndex = i;
-                break;
-            }
-        }
+    uint32_t graphicsQueueIndex = findQueueFamily(queueFamilies, VK_QUEUE_GRAPHICS_BIT, 0);
+    if (graphicsQueueIndex == QUEUE_FAMILY_NONE) {
+        return false;
     }
 
+    // dedicated dma engine first, then any family other than graphics, otherwise share the graphics queue
+    uint32_t transferQueueIndex = findQueueFamily(queueFamilies, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+    if (transferQueueIndex == QUEUE_FAMILY_NONE) {
+        transferQueueIndex = findQueueFamily(queueFamilies, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT);
+    }
+    if (transferQueueIndex == QUEUE_FAMILY_NONE) {
+        transferQueueIndex = graphicsQueueIndex;
+    }
+
+    // there is no async compute queue: culling reads the previous frame's depth pyramid and feeds the draws right after it,
+    // so it stays in the frame command buffer on the graphics queue instead of paying for ownership transfers and a timeline wait
     float priorities[] = { 1.f };
-    VkDeviceQueueCreateInfo queueCreateInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
-    queueCreateInfo.queueFamilyIndex = graphicsQueueIndex;
-    queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = priorities;
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    for (uint32_t familyIndex : { graphicsQueueIndex, transferQueueIndex }) {
+        bool created = false;
+        for (auto& queueCreateInfo : queueCreateInfos) {
+            created |= queueCreateInfo.queueFamilyIndex == familyIndex;
+        }
+        if (created) {
+            continue;
+        }
+        VkDeviceQueueCreateInfo queueCreateInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+        queueCreateInfo.queueFamilyIndex = familyIndex;
+        queueCreateInfo.queueCount = 1;
+        queueCreateInfo.pQueuePriorities = priorities;
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
 
-    VkPhysicalDeviceFeatures enabledFeatures = {};
-    
-    std::vector<const char*> enabledDeviceExtensions { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    // optional features are enabled when supported and reported in context->features, callers pick a fallback otherwise
+    bool vulkan12 = context->physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2;
+    bool vulkan13 = context->physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_3;
+    VkPhysicalDeviceVulkan13Features supportedFeatures13 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+    VkPhysicalDeviceVulkan12Features supportedFeatures12 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    supportedFeatures12.pNext = vulkan13 ? &supportedFeatures13 : nullptr;
+    VkPhysicalDeviceFeatures2 supportedFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    supportedFeatures.pNext = vulkan12 ? &supportedFeatures12 : nullptr;
+    vkGetPhysicalDeviceFeatures2(context->physicalDevice, &supportedFeatures);
+
+    // every queue and frame is synchronized through timeline semaphores, so they are the one hard requirement
+    if (!vulkan12 || !supportedFeatures12.timelineSemaphore) {
+        LOG(LOG_ERROR_UTILS, false, "timeline semaphores unsupported");
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan13Features enabledFeatures13 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+    VkPhysicalDeviceVulkan12Features enabledFeatures12 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    VkPhysicalDeviceFeatures2 enabledFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    enabledFeatures.pNext = &enabledFeatures12;
+    enabledFeatures12.timelineSemaphore = VK_TRUE;
+    enabledFeatures.features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+    enabledFeatures.features.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+    enabledFeatures.features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+    enabledFeatures.features.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+    enabledFeatures12.drawIndirectCount = supportedFeatures12.drawIndirectCount;
+    // descriptor indexing is core since 1.2, only the parts the bindless table needs are turned on
+    // the descriptorIndexing bit itself stands for the extension's whole minimum set, which the table doesn't need
+    bool descriptorIndexing = supportedFeatures12.runtimeDescriptorArray && supportedFeatures12.descriptorBindingPartiallyBound
+        && supportedFeatures12.descriptorBindingVariableDescriptorCount && supportedFeatures12.shaderSampledImageArrayNonUniformIndexing
+        && supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind && supportedFeatures12.descriptorBindingStorageBufferUpdateAfterBind;
+    if (descriptorIndexing) {
+        enabledFeatures12.runtimeDescriptorArray = VK_TRUE;
+        enabledFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+        enabledFeatures12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        enabledFeatures12.shaderStorageBufferArrayNonUniformIndexing = supportedFeatures12.shaderStorageBufferArrayNonUniformIndexing;
+        enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        enabledFeatures12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    }
+    // the dynamic rendering path does its layout transitions with synchronization2, so it needs both
+    bool dynamicRendering = vulkan13 && supportedFeatures13.dynamicRendering && supportedFeatures13.synchronization2;
+    if (dynamicRendering) {
+        enabledFeatures13.dynamicRendering = VK_TRUE;
+        enabledFeatures13.synchronization2 = VK_TRUE;
+        enabledFeatures12.pNext = &enabledFeatures13;
+    }
+
+    context->features.multiDrawIndirect = enabledFeatures.features.multiDrawIndirect;
+    context->features.drawIndirectFirstInstance = enabledFeatures.features.drawIndirectFirstInstance;
+    context->features.textureCompressionBC = enabledFeatures.features.textureCompressionBC;
+    context->features.textureCompressionASTC = enabledFeatures.features.textureCompressionASTC_LDR;
+    context->features.drawIndirectCount = enabledFeatures12.drawIndirectCount;
+    context->features.descriptorIndexing = descriptorIndexing;
+    context->features.dynamicRendering = dynamicRendering;
+
+    std::vector<const char*> enabledDeviceExtensions;
+    if (!context->headless) {
+        enabledDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    // present id + present wait let the window wait for a frame to reach the display instead of guessing
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+    if (!context->headless && isDeviceExtensionAvailable(context->physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+        && isDeviceExtensionAvailable(context->physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        VkPhysicalDeviceFeatures2 presentFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+        presentFeatures.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(context->physicalDevice, &presentFeatures);
+        if (presentIdFeatures.presentId && presentWaitFeatures.presentWait) {
+            enabledDeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            enabledDeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            presentWaitFeatures.pNext = enabledFeatures.pNext;
+            enabledFeatures.pNext = &presentIdFeatures;
+            context->features.presentWait = true;
+        }
+    }
 
     VkDeviceCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
-    createInfo.queueCreateInfoCount = 1;
-    createInfo.pQueueCreateInfos = &queueCreateInfo;
+    createInfo.pNext = &enabledFeatures;
+    createInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
+    createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.enabledExtensionCount = enabledDeviceExtensions.size();
     createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
-    createInfo.pEnabledFeatures = &enabledFeatures;
 
     VAC(vkCreateDevice(context->physicalDevice, &createInfo, 0, &context->device));
 
     context->graphicsQueue.familyIndex = graphicsQueueIndex;
     vkGetDeviceQueue(context->device, graphicsQueueIndex, 0, &context->graphicsQueue.queue);
+    context->transferQueue.familyIndex = transferQueueIndex;
+    vkGetDeviceQueue(context->device, transferQueueIndex, 0, &context->transferQueue.queue);
+
+    // one timeline per role even when roles share a VkQueue, so frame values only count frame submissions
+    createTimeline(context, context->graphicsQueue);
+    createTimeline(context, context->transferQueue);
+
+    LOG(LOG_DEFAULT_UTILS, false, "queue-families: graphics %u, transfer %u", graphicsQueueIndex, transferQueueIndex);
 
     return true;
 }
 
-void initVulkan(VulkanContext*& context) {
-    context = new VulkanContext;
-    
+VkBufferMemoryBarrier queueOwnershipBarrier(const VulkanBuffer& buffer, const VulkanQueue& source, const VulkanQueue& destination, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
+    VkBufferMemoryBarrier barrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+    barrier.srcQueueFamilyIndex = source.familyIndex;
+    barrier.dstQueueFamilyIndex = destination.familyIndex;
+    barrier.buffer = buffer.buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    return barrier;
+}
+
+VkImageMemoryBarrier queueOwnershipBarrier(const VulkanImage& image, const VulkanQueue& source, const VulkanQueue& destination, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
+    VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = source.familyIndex;
+    barrier.dstQueueFamilyIndex = destination.familyIndex;
+    barrier.image = image.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+    return barrier;
+}
+
+void initVulkan(VulkanContext*& context, bool headless) {
+    context = new VulkanContext {};
+    context->headless = headless;
+
     if (!initVulkanInstance(context)) {
         LOG(LOG_ERROR_UTILS, false, "error creating vulkan instance");
     }
@@ -182,26 +381,68 @@ void initVulkan(VulkanContext*& context) {
     if (!createLogicalDevice(context)) {
         LOG(LOG_ERROR_UTILS, false, "errror creating logical device");
     }
+
+    createDeletionQueue(context);
+    createProfiler(context);
+    createAllocator(context);
+    createUploader(context, UPLOAD_RING_SIZE);
+    createShaderLibrary(context);
+    createLayoutCache(context);
+    createPipelineCache(context, PIPELINE_CACHE_FILENAME);
+    createUniformRing(context, UNIFORM_RING_FRAME_SIZE);
+    createBindlessTable(context, BINDLESS_TEXTURE_COUNT, BINDLESS_BUFFER_COUNT);
+
+    // one core stays with the thread that records and submits frames
+    context->threadPool = new ThreadPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    createPipelineRegistry(context);
+    createRecorder(context);
+    createTextureStreamer(context, 0);
 }
 
 void cleanVulkan(VulkanContext*& context) {
     vkDeviceWaitIdle(context->device),
+    destroyDeletionQueue(context);
+    destroyTextureStreamer(context);
+    destroyRecorder(context);
+    destroyPipelineRegistry(context);
+    delete context->threadPool;
+    destroyBindlessTable(context);
+    destroyUniformRing(context);
+    destroyPipelineCache(context);
+    destroyLayoutCache(context);
+    destroyShaderLibrary(context);
+    destroyUploader(context);
+    destroyAllocator(context);
+    destroyProfiler(context);
+    destroyTimeline(context, context->transferQueue);
+    destroyTimeline(context, context->graphicsQueue);
     vkDestroyDevice(context->device, 0);
-    DestroyDebugUtilsMessengerEXT(context->instance, debugMessenger, nullptr);
+    if (debugMessenger != VK_NULL_HANDLE) {
+        DestroyDebugUtilsMessengerEXT(context->instance, debugMessenger, nullptr);
+        debugMessenger = VK_NULL_HANDLE;
+    }
     vkDestroyInstance(context->instance, 0);
     delete context;
     context = nullptr;
 }
 
 void createFramebuffers(VulkanContext* context, VulkanSwapchain& swapchain, VkRenderPass& renderPass, std::vector<VkFramebuffer>& framebuffers) {
-    framebuffers.resize(swapchain.images.size());
-    for (size_t i {0}; i < swapchain.images.size(); i++) {
+    createFramebuffers(context, swapchain.imageViews, swapchain.width, swapchain.height, renderPass, framebuffers);
+}
+
+void createFramebuffers(VulkanContext* context, const std::vector<VkImageView>& imageViews, uint32_t width, uint32_t height, VkRenderPass& renderPass, std::vector<VkFramebuffer>& framebuffers,
+    const std::vector<VkImageView>& sharedAttachments) {
+    framebuffers.resize(imageViews.size());
+    std::vector<VkImageView> attachments(1 + sharedAttachments.size());
+    std::copy(sharedAttachments.begin(), sharedAttachments.end(), attachments.begin() + 1);
+    for (size_t i {0}; i < imageViews.size(); i++) {
+        attachments[0] = imageViews[i];
         VkFramebufferCreateInfo createInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
         createInfo.renderPass = renderPass;
-        createInfo.attachmentCount = 1;
-        createInfo.pAttachments = &swapchain.imageViews[i];
-        createInfo.width = swapchain.width;
-        createInfo.height = swapchain.height;
+        createInfo.attachmentCount = (uint32_t)attachments.size();
+        createInfo.pAttachments = attachments.data();
+        createInfo.width = width;
+        createInfo.height = height;
         createInfo.layers = 1;
         VAC(vkCreateFramebuffer(context->device, &createInfo, 0, &framebuffers[i]));
     }
@@ -213,48 +454,3 @@ void destroyFramebuffers(VulkanContext* context, std::vector<VkFramebuffer>& fra
     }
     framebuffers.clear();
 }
-
-void createFence(VulkanContext* context, std::vector<VkFence>& fences) {
-    fences.resize(MAX_FRAMES_IN_FLIGHT);
-
-    VkFenceCreateInfo createInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-    createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VAC(vkCreateFence(context->device, &createInfo, 0, &fences[i]));
-    }
-}
-
-void createSemaphore(VulkanContext* context, std::vector<VkSemaphore>& semaphores) {
-    semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    VkSemaphoreCreateInfo createInfo { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-    
-    for (size_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VAC(vkCreateSemaphore(context->device, &createInfo, 0, &semaphores[i]));
-    }
-}
-
-void createCommandPool(VulkanContext* context, VkCommandPool* commandPool) {
-    VkCommandPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    createInfo.queueFamilyIndex = context->graphicsQueue.familyIndex;
-    VAC(vkCreateCommandPool(context->device, &createInfo, 0, commandPool));
-}
-
-void allocateCommandBuffers(VulkanContext* context, VkCommandPool& commandPool, std::vector<VkCommandBuffer>& commandBuffers) {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-    allocateInfo.commandPool = commandPool;
-    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-    VAC(vkAllocateCommandBuffers(context->device, &allocateInfo, commandBuffers.data()));
-}
-
-void destroySyncObjects(VulkanContext* context, std::vector<VkSemaphore>& acquireSemaphores, std::vector<VkSemaphore>& releaseSemaphores, std::vector<VkFence>& fences)
-{
-    for (size_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(context->device, acquireSemaphores[i], 0);
-        vkDestroySemaphore(context->device, releaseSemaphores[i], 0);
-        vkDestroyFence(context->device, fences[i], 0);
-    }
-}
\ No newline at end of file
@@ -13,30 +13,58 @@ uint32_t findMemoryType(VulkanContext* context, uint32_t typeFilter, VkMemoryPro
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void createVertexBuffer(VulkanContext* context, const std::vector<Vertex>& vertices, VkBuffer* vertexBuffer, VkDeviceMemory* vertexBufferMemory) {
+bool hasMemoryType(VulkanContext* context, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void createBuffer(VulkanContext* context, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VulkanBuffer& buffer) {
+    buffer = {};
+    buffer.size = size;
+
     VkBufferCreateInfo bufferInfo { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-    bufferInfo.size = sizeof(vertices[0]) * vertices.size();
-    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    VAC(vkCreateBuffer(context->device, &bufferInfo, nullptr, vertexBuffer));
+    VAC(vkCreateBuffer(context->device, &bufferInfo, nullptr, &buffer.buffer));
 
     VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(context->device, *vertexBuffer, &memRequirements);
+    vkGetBufferMemoryRequirements(context->device, buffer.buffer, &memRequirements);
+
+    allocateMemory(context, memRequirements, properties, buffer.allocation);
+    VAC(vkBindBufferMemory(context->device, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset));
+}
+
+void destroyBuffer(VulkanContext* context, VulkanBuffer& buffer) {
+    vkDestroyBuffer(context->device, buffer.buffer, 0);
+    freeMemory(context, buffer.allocation);
+    buffer = {};
+}
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(context, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    VAC(vkAllocateMemory(context->device, &allocInfo, nullptr, vertexBufferMemory));
+void createVertexBuffer(VulkanContext* context, const std::vector<Vertex>& vertices, VulkanBuffer& vertexBuffer) {
+    std::vector<PackedVertex> packed = packVertices(vertices);
+    VkDeviceSize size = sizeof(packed[0]) * packed.size();
+    createBuffer(context, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer);
+    uploadBuffer(context, vertexBuffer, 0, packed.data(), size);
+}
 
-    vkBindBufferMemory(context->device, *vertexBuffer, *vertexBufferMemory, 0);
+void destroyVertexBuffer(VulkanContext* context, VulkanBuffer& vertexBuffer) {
+    destroyBuffer(context, vertexBuffer);
+}
 
-    void* data;
-    vkMapMemory(context->device, *vertexBufferMemory, 0, bufferInfo.size, 0, &data);
-        memcpy(data, vertices.data(), (size_t) bufferInfo.size);
-    vkUnmapMemory(context->device, *vertexBufferMemory);
+void createIndexBuffer(VulkanContext* context, const std::vector<uint32_t>& indices, VulkanBuffer& indexBuffer) {
+    VkDeviceSize size = sizeof(indices[0]) * indices.size();
+    createBuffer(context, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer);
+    uploadBuffer(context, indexBuffer, 0, indices.data(), size);
 }
 
-void destroyVertexBuffer(VulkanContext* context, VkBuffer& vertexBuffer) {
-    vkDestroyBuffer(context->device, vertexBuffer, 0);
-}
\ No newline at end of file
+void destroyIndexBuffer(VulkanContext* context, VulkanBuffer& indexBuffer) {
+    destroyBuffer(context, indexBuffer);
+}
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include "vulkan-base.h"
+
+const uint32_t CULL_GROUP_SIZE = 64;
+const uint32_t HIZ_GROUP_SIZE = 8;
+
+// std140 mirror of CullParameters in cull-comp.glsl
+struct CullParameters {
+    glm::mat4 viewProjection;
+    glm::vec4 planes[6];
+    glm::vec4 cameraPosition;
+    glm::vec2 projectionScale;
+    glm::vec2 hiZSize;
+    uint32_t objectCount;
+    uint32_t hiZEnabled;
+    uint32_t compact;
+    uint32_t padding;
+};
+
+struct GpuMesh {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    float radius;
+};
+
+struct HiZParameters {
+    int32_t sourceSize[2];
+    int32_t destinationSize[2];
+};
+
+// gribb/hartmann plane extraction for a [0, 1] depth range, normalized so distances are in world units
+void extractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row2;
+    planes[5] = row3 - row2;
+    for (int i {0}; i < 6; i++) {
+        planes[i] = planes[i] / glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+    }
+}
+
+void createCuller(VulkanContext* context, uint32_t maxObjects, VulkanCuller& culler) {
+    culler = {};
+    culler.maxObjects = maxObjects;
+    // per-object commands need firstInstance, and without multi draw indirect the result can't be consumed in one call
+    culler.supported = context->features.drawIndirectFirstInstance && context->features.multiDrawIndirect;
+    if (!culler.supported) {
+        LOG(LOG_DEFAULT_UTILS, false, "culling: multiDrawIndirect/drawIndirectFirstInstance unsupported, falling back to cpu draw lists");
+        return;
+    }
+    culler.compact = context->features.drawIndirectCount;
+
+    // set layouts come from the shaders, the layout cache owns them
+    createComputePipeline(context, "spvs/cull-comp.spv", culler.cullPipeline);
+    culler.cullSetLayout = culler.cullPipeline.setLayouts[0];
+    createComputePipeline(context, "spvs/hiz-comp.spv", culler.hiZPipeline);
+    culler.hiZSetLayout = culler.hiZPipeline.setLayouts[0];
+
+    VkSamplerCreateInfo samplerInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VAC(vkCreateSampler(context->device, &samplerInfo, 0, &culler.sampler));
+
+    // bound in place of a pyramid when occlusion culling is off, the shader never samples it then
+    createImage(context, 1, 1, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, culler.emptyHiZ);
+    float farDepth = 1.0f;
+    uploadImage(context, culler.emptyHiZ, 0, &farDepth, sizeof(farDepth), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    for (uint32_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        createBuffer(context, sizeof(VkDrawIndexedIndirectCommand) * (VkDeviceSize)maxObjects, usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, culler.commands[i]);
+        createBuffer(context, sizeof(Instance) * (VkDeviceSize)maxObjects, usage | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, culler.visibleInstances[i]);
+        createBuffer(context, sizeof(uint32_t), usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, culler.drawCount[i]);
+    }
+}
+
+void destroyCuller(VulkanContext* context, VulkanCuller& culler) {
+    if (!culler.supported) {
+        return;
+    }
+    for (uint32_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        destroyBuffer(context, culler.commands[i]);
+        destroyBuffer(context, culler.visibleInstances[i]);
+        destroyBuffer(context, culler.drawCount[i]);
+    }
+    destroyImage(context, culler.emptyHiZ);
+    vkDestroySampler(context->device, culler.sampler, 0);
+    destroyPipeline(context, &culler.cullPipeline);
+    destroyPipeline(context, &culler.hiZPipeline);
+    culler = {};
+}
+
+// the pyramid starts at half the depth resolution so every level is a 2x2 reduction
+void createHiZ(VulkanContext* context, uint32_t depthWidth, uint32_t depthHeight, VulkanHiZ& hiZ) {
+    hiZ = {};
+    hiZ.depthWidth = depthWidth;
+    hiZ.depthHeight = depthHeight;
+    uint32_t width = std::max(1u, depthWidth / 2);
+    uint32_t height = std::max(1u, depthHeight / 2);
+    uint32_t mipLevels {1};
+    while ((std::max(width, height) >> mipLevels) > 0) {
+        mipLevels++;
+    }
+    createImage(context, width, height, mipLevels, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, hiZ.image);
+
+    hiZ.mipViews.resize(mipLevels);
+    for (uint32_t i {0}; i < mipLevels; i++) {
+        VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        viewInfo.image = hiZ.image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+        VAC(vkCreateImageView(context->device, &viewInfo, 0, &hiZ.mipViews[i]));
+    }
+}
+
+void destroyHiZ(VulkanContext* context, VulkanHiZ& hiZ) {
+    for (auto view : hiZ.mipViews) {
+        vkDestroyImageView(context->device, view, 0);
+    }
+    destroyImage(context, hiZ.image);
+    hiZ = {};
+}
+
+// the depth view has to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, the pyramid stays in VK_IMAGE_LAYOUT_GENERAL
+void buildHiZ(VulkanContext* context, VulkanFrame& frame, const VulkanCuller& culler, VulkanHiZ& hiZ, VkImageView depthView) {
+    if (!culler.supported) {
+        return;
+    }
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+    uint32_t scope = beginGpuScope(context, frame.index, commandBuffer, "hi-z");
+
+    VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    barrier.srcAccessMask = hiZ.valid ? VK_ACCESS_SHADER_READ_BIT : 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout = hiZ.valid ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = hiZ.image.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, hiZ.image.mipLevels, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler.hiZPipeline.pipeline);
+
+    uint32_t sourceWidth = hiZ.depthWidth;
+    uint32_t sourceHeight = hiZ.depthHeight;
+    for (uint32_t level {0}; level < hiZ.image.mipLevels; level++) {
+        uint32_t width = std::max(1u, sourceWidth / 2);
+        uint32_t height = std::max(1u, sourceHeight / 2);
+
+        VkDescriptorSet descriptorSet = allocateTransientDescriptorSet(context, frame, culler.hiZSetLayout);
+        VkDescriptorImageInfo sourceInfo = { culler.sampler, level == 0 ? depthView : hiZ.mipViews[level - 1], level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL };
+        VkDescriptorImageInfo destinationInfo = { VK_NULL_HANDLE, hiZ.mipViews[level], VK_IMAGE_LAYOUT_GENERAL };
+        VkWriteDescriptorSet writes[2] = { { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET }, { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET } };
+        writes[0].dstSet = descriptorSet;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo = &sourceInfo;
+        writes[1].dstSet = descriptorSet;
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = &destinationInfo;
+        vkUpdateDescriptorSets(context->device, 2, writes, 0, 0);
+
+        HiZParameters parameters = { { (int32_t)sourceWidth, (int32_t)sourceHeight }, { (int32_t)width, (int32_t)height } };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler.hiZPipeline.pipelineLayout, 0, 1, &descriptorSet, 0, 0);
+        vkCmdPushConstants(commandBuffer, culler.hiZPipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+        vkCmdDispatch(commandBuffer, (width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+        sourceWidth = width;
+        sourceHeight = height;
+    }
+    endGpuScope(context, frame.index, commandBuffer, scope);
+    hiZ.valid = true;
+}
+
+bool cullDrawList(VulkanContext* context, VulkanFrame& frame, VulkanCuller& culler, VulkanDrawList& drawList, const VulkanCullView& view) {
+    if (!culler.supported) {
+        return false;
+    }
+
+    uint32_t objectCount {0};
+    for (auto& instances : drawList.instances) {
+        objectCount += (uint32_t)instances.size();
+    }
+    if (objectCount > culler.maxObjects) {
+        throw std::runtime_error("more objects than the culler was created for!");
+    }
+
+    const VkPhysicalDeviceLimits& limits = context->physicalDeviceProperties.limits;
+    VkDeviceSize storageAlignment = std::max<VkDeviceSize>(16, limits.minStorageBufferOffsetAlignment);
+    VkDeviceSize uniformAlignment = std::max<VkDeviceSize>(16, limits.minUniformBufferOffsetAlignment);
+
+    Instance* instanceData;
+    uint32_t* meshIds;
+    GpuMesh* meshes;
+    CullParameters* parameters;
+    VkDeviceSize instanceSize = sizeof(Instance) * (VkDeviceSize)std::max(1u, objectCount);
+    VkDeviceSize meshIdSize = sizeof(uint32_t) * (VkDeviceSize)std::max(1u, objectCount);
+    VkDeviceSize meshSize = sizeof(GpuMesh) * (VkDeviceSize)std::max<size_t>(1, drawList.meshes.size());
+    VkDeviceSize instanceOffset = allocateTransient(context, frame, instanceSize, storageAlignment, (void**)&instanceData);
+    VkDeviceSize meshIdOffset = allocateTransient(context, frame, meshIdSize, storageAlignment, (void**)&meshIds);
+    VkDeviceSize meshOffset = allocateTransient(context, frame, meshSize, storageAlignment, (void**)&meshes);
+    VkDeviceSize parameterOffset = allocateTransient(context, frame, sizeof(CullParameters), uniformAlignment, (void**)&parameters);
+
+    uint32_t object {0};
+    for (size_t i {0}; i < drawList.meshes.size(); i++) {
+        const VulkanMesh& mesh = drawList.meshes[i];
+        meshes[i] = { mesh.indexCount, mesh.firstIndex, mesh.vertexOffset, mesh.radius };
+        for (auto& instance : drawList.instances[i]) {
+            instanceData[object] = instance;
+            meshIds[object] = (uint32_t)i;
+            object++;
+        }
+    }
+
+    *parameters = {};
+    parameters->viewProjection = view.viewProjection;
+    extractFrustumPlanes(view.viewProjection, parameters->planes);
+    parameters->cameraPosition = glm::vec4(view.cameraPosition, 1.0f);
+    parameters->projectionScale = view.projectionScale;
+    parameters->objectCount = objectCount;
+    parameters->compact = culler.compact ? 1 : 0;
+    parameters->hiZEnabled = view.hiZ && view.hiZ->valid ? 1 : 0;
+    if (parameters->hiZEnabled) {
+        parameters->hiZSize = glm::vec2((float)view.hiZ->image.width, (float)view.hiZ->image.height);
+    }
+
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+    uint32_t index = frame.index;
+    uint32_t scope = beginGpuScope(context, index, commandBuffer, "cull");
+    vkCmdFillBuffer(commandBuffer, culler.drawCount[index].buffer, 0, sizeof(uint32_t), 0);
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+    VkDescriptorSet descriptorSet = allocateTransientDescriptorSet(context, frame, culler.cullSetLayout);
+    VkBuffer transient = frame.transientBuffer.buffer;
+    VkDescriptorBufferInfo bufferInfos[7] = {
+        { transient, parameterOffset, sizeof(CullParameters) },
+        { transient, instanceOffset, instanceSize },
+        { transient, meshIdOffset, meshIdSize },
+        { transient, meshOffset, meshSize },
+        { culler.commands[index].buffer, 0, VK_WHOLE_SIZE },
+        { culler.visibleInstances[index].buffer, 0, VK_WHOLE_SIZE },
+        { culler.drawCount[index].buffer, 0, VK_WHOLE_SIZE }
+    };
+    bool hiZEnabled = parameters->hiZEnabled != 0;
+    VkDescriptorImageInfo hiZInfo = { culler.sampler, hiZEnabled ? view.hiZ->image.imageView : culler.emptyHiZ.imageView, hiZEnabled ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet writes[8];
+    for (uint32_t i {0}; i < 8; i++) {
+        writes[i] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        writes[i].dstSet = descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        if (i == 0) {
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        } else if (i < 7) {
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        } else {
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        }
+        writes[i].pBufferInfo = i < 7 ? &bufferInfos[i] : nullptr;
+        writes[i].pImageInfo = i < 7 ? nullptr : &hiZInfo;
+    }
+    vkUpdateDescriptorSets(context->device, 8, writes, 0, 0);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler.cullPipeline.pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, culler.cullPipeline.pipelineLayout, 0, 1, &descriptorSet, 0, 0);
+    vkCmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+    endGpuScope(context, index, commandBuffer, scope);
+
+    culler.objectCount[index] = objectCount;
+    return true;
+}
+
+void recordCulledDrawList(VulkanContext* context, VkCommandBuffer commandBuffer, uint32_t frameIndex, const VulkanCuller& culler, const VulkanDrawList& drawList) {
+    uint32_t objectCount = culler.objectCount[frameIndex];
+    if (objectCount == 0) {
+        return;
+    }
+
+    VkBuffer vertexBuffers[] = { drawList.vertexArena.buffer, culler.visibleInstances[frameIndex].buffer };
+    VkDeviceSize offsets[] = { 0, 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, drawList.indexArena.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (culler.compact) {
+        vkCmdDrawIndexedIndirectCount(commandBuffer, culler.commands[frameIndex].buffer, 0, culler.drawCount[frameIndex].buffer, 0, objectCount, stride);
+    } else {
+        vkCmdDrawIndexedIndirect(commandBuffer, culler.commands[frameIndex].buffer, 0, objectCount, stride);
+    }
+}
@@ -0,0 +1,91 @@
+#include <deque>
+#include <algorithm>
+#include "vulkan-base.h"
+
+struct PendingDeletion {
+    uint64_t serial;
+    std::function<void()> destroy;
+};
+
+struct VulkanDeletionQueue {
+    // sorted by serial, retires from the front
+    std::deque<PendingDeletion> pending;
+};
+
+void createDeletionQueue(VulkanContext* context) {
+    context->deletionQueue = new VulkanDeletionQueue {};
+}
+
+void destroyDeletionQueue(VulkanContext* context) {
+    flushDeletions(context);
+    delete context->deletionQueue;
+    context->deletionQueue = nullptr;
+}
+
+uint64_t recordingSerial(VulkanContext* context) {
+    return context->graphicsQueue.submitted + 1;
+}
+
+void deferDeletion(VulkanContext* context, std::function<void()> destroy, uint64_t lastUsedSerial) {
+    // the frame being recorded may still reference the object, so by default it has to retire as well
+    uint64_t serial = lastUsedSerial == 0 ? recordingSerial(context) : lastUsedSerial;
+    if (serial <= completedTimelineValue(context, context->graphicsQueue)) {
+        destroy();
+        return;
+    }
+    auto& pending = context->deletionQueue->pending;
+    auto position = std::upper_bound(pending.begin(), pending.end(), serial, [](uint64_t value, const PendingDeletion& deletion) {
+        return value < deletion.serial;
+    });
+    pending.insert(position, { serial, std::move(destroy) });
+}
+
+void deferDestroyBuffer(VulkanContext* context, VulkanBuffer& buffer, uint64_t lastUsedSerial) {
+    VulkanBuffer retired = buffer;
+    buffer = {};
+    deferDeletion(context, [context, retired]() mutable {
+        destroyBuffer(context, retired);
+    }, lastUsedSerial);
+}
+
+void deferDestroyImage(VulkanContext* context, VulkanImage& image, uint64_t lastUsedSerial) {
+    VulkanImage retired = image;
+    image = {};
+    deferDeletion(context, [context, retired]() mutable {
+        destroyImage(context, retired);
+    }, lastUsedSerial);
+}
+
+void deferDestroyPipeline(VulkanContext* context, VulkanPipeline& pipeline, uint64_t lastUsedSerial) {
+    VulkanPipeline retired = pipeline;
+    pipeline = {};
+    deferDeletion(context, [context, retired]() mutable {
+        destroyPipeline(context, &retired);
+    }, lastUsedSerial);
+}
+
+void deferDestroyFramebuffers(VulkanContext* context, std::vector<VkFramebuffer>& framebuffers, uint64_t lastUsedSerial) {
+    std::vector<VkFramebuffer> retired;
+    retired.swap(framebuffers);
+    deferDeletion(context, [context, retired]() mutable {
+        destroyFramebuffers(context, retired);
+    }, lastUsedSerial);
+}
+
+void collectDeletions(VulkanContext* context) {
+    auto& pending = context->deletionQueue->pending;
+    uint64_t completed = completedTimelineValue(context, context->graphicsQueue);
+    while (!pending.empty() && pending.front().serial <= completed) {
+        pending.front().destroy();
+        pending.pop_front();
+    }
+}
+
+void flushDeletions(VulkanContext* context) {
+    vkDeviceWaitIdle(context->device);
+    auto& pending = context->deletionQueue->pending;
+    while (!pending.empty()) {
+        pending.front().destroy();
+        pending.pop_front();
+    }
+}
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include "vulkan-base.h"
+
+const uint32_t MAX_DESCRIPTOR_SETS_PER_POOL = 4096;
+const VkShaderStageFlags DESCRIPTOR_STAGES = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+// descriptors per set of each type, a pool holds setsPerPool times these
+const std::pair<VkDescriptorType, uint32_t> DESCRIPTOR_POOL_RATIOS[] = {
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+};
+
+struct VulkanUniformRing {
+    VulkanBuffer buffer;
+    VkDeviceSize alignment;
+    VkDeviceSize frameSize;
+    VkDeviceSize range;
+    std::array<VkDeviceSize, MAX_FRAMES_IN_FLIGHT> heads;
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+};
+
+struct VulkanBindlessTable {
+    uint32_t capacity[2];
+    uint32_t count[2];
+    std::vector<uint32_t> freeSlots[2];
+    // slots released while a frame was recorded, reused once that frame retired
+    std::array<std::vector<uint32_t>, MAX_FRAMES_IN_FLIGHT> releasedSlots[2];
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+};
+
+const uint32_t BINDLESS_TEXTURES = 0;
+const uint32_t BINDLESS_BUFFERS = 1;
+
+VkDescriptorPool createDescriptorPool(VulkanContext* context, uint32_t maxSets) {
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (auto& ratio : DESCRIPTOR_POOL_RATIOS) {
+        poolSizes.push_back({ ratio.first, ratio.second * maxSets });
+    }
+    VkDescriptorPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    createInfo.maxSets = maxSets;
+    createInfo.poolSizeCount = (uint32_t)poolSizes.size();
+    createInfo.pPoolSizes = poolSizes.data();
+    VkDescriptorPool descriptorPool;
+    VAC(vkCreateDescriptorPool(context->device, &createInfo, 0, &descriptorPool));
+    return descriptorPool;
+}
+
+void createDescriptorAllocator(VulkanContext* context, uint32_t setsPerPool, VulkanDescriptorAllocator& allocator) {
+    allocator = {};
+    allocator.setsPerPool = setsPerPool;
+}
+
+void destroyDescriptorAllocator(VulkanContext* context, VulkanDescriptorAllocator& allocator) {
+    for (auto pool : allocator.usedPools) {
+        vkDestroyDescriptorPool(context->device, pool, 0);
+    }
+    for (auto pool : allocator.freePools) {
+        vkDestroyDescriptorPool(context->device, pool, 0);
+    }
+    allocator = {};
+}
+
+void resetDescriptorAllocator(VulkanContext* context, VulkanDescriptorAllocator& allocator) {
+    for (auto pool : allocator.usedPools) {
+        VAC(vkResetDescriptorPool(context->device, pool, 0));
+        allocator.freePools.push_back(pool);
+    }
+    allocator.usedPools.clear();
+    allocator.currentPool = VK_NULL_HANDLE;
+}
+
+void nextDescriptorPool(VulkanContext* context, VulkanDescriptorAllocator& allocator) {
+    if (!allocator.freePools.empty()) {
+        allocator.currentPool = allocator.freePools.back();
+        allocator.freePools.pop_back();
+    } else {
+        // every new pool is twice the size of the last, so a busy frame settles on a few pools quickly
+        allocator.currentPool = createDescriptorPool(context, allocator.setsPerPool);
+        allocator.setsPerPool = std::min(allocator.setsPerPool * 2, MAX_DESCRIPTOR_SETS_PER_POOL);
+    }
+    allocator.usedPools.push_back(allocator.currentPool);
+}
+
+VkDescriptorSet allocateDescriptorSet(VulkanContext* context, VulkanDescriptorAllocator& allocator, VkDescriptorSetLayout layout) {
+    if (allocator.currentPool == VK_NULL_HANDLE) {
+        nextDescriptorPool(context, allocator);
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    allocateInfo.descriptorPool = allocator.currentPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &layout;
+    VkDescriptorSet descriptorSet;
+    VkResult result = vkAllocateDescriptorSets(context->device, &allocateInfo, &descriptorSet);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        nextDescriptorPool(context, allocator);
+        allocateInfo.descriptorPool = allocator.currentPool;
+        result = vkAllocateDescriptorSets(context->device, &allocateInfo, &descriptorSet);
+    }
+    VAC(result);
+    return descriptorSet;
+}
+
+void createUniformRing(VulkanContext* context, VkDeviceSize frameSize) {
+    VulkanUniformRing* ring = new VulkanUniformRing {};
+    context->uniformRing = ring;
+
+    const VkPhysicalDeviceLimits& limits = context->physicalDeviceProperties.limits;
+    ring->alignment = std::max<VkDeviceSize>(16, limits.minUniformBufferOffsetAlignment);
+    ring->frameSize = (frameSize + ring->alignment - 1) / ring->alignment * ring->alignment;
+    ring->range = std::min<VkDeviceSize>(UNIFORM_RING_RANGE, limits.maxUniformBufferRange);
+    // the descriptor always spans range bytes, so the last offset of the last frame needs that much tail
+    createBuffer(context, ring->frameSize * MAX_FRAMES_IN_FLIGHT + ring->range, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring->buffer);
+
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = DESCRIPTOR_STAGES;
+    VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    VAC(vkCreateDescriptorSetLayout(context->device, &layoutInfo, 0, &ring->setLayout));
+
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+    VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VAC(vkCreateDescriptorPool(context->device, &poolInfo, 0, &ring->descriptorPool));
+
+    VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    allocateInfo.descriptorPool = ring->descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &ring->setLayout;
+    VAC(vkAllocateDescriptorSets(context->device, &allocateInfo, &ring->descriptorSet));
+
+    VkDescriptorBufferInfo bufferInfo = { ring->buffer.buffer, 0, ring->range };
+    VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    write.dstSet = ring->descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context->device, 1, &write, 0, 0);
+}
+
+void destroyUniformRing(VulkanContext* context) {
+    VulkanUniformRing* ring = context->uniformRing;
+    vkDestroyDescriptorPool(context->device, ring->descriptorPool, 0);
+    vkDestroyDescriptorSetLayout(context->device, ring->setLayout, 0);
+    destroyBuffer(context, ring->buffer);
+    delete ring;
+    context->uniformRing = nullptr;
+}
+
+void resetUniformRing(VulkanContext* context, uint32_t frameIndex) {
+    context->uniformRing->heads[frameIndex] = 0;
+}
+
+uint32_t pushUniforms(VulkanContext* context, VulkanFrame& frame, const void* data, VkDeviceSize size) {
+    VulkanUniformRing* ring = context->uniformRing;
+    if (size > ring->range) {
+        throw std::runtime_error("uniform block larger than the uniform ring range!");
+    }
+    VkDeviceSize& head = ring->heads[frame.index];
+    if (head + size > ring->frameSize) {
+        throw std::runtime_error("uniform ring exhausted!");
+    }
+    VkDeviceSize offset = ring->frameSize * frame.index + head;
+    memcpy((uint8_t*)ring->buffer.allocation.mapped + offset, data, size);
+    head = (head + size + ring->alignment - 1) / ring->alignment * ring->alignment;
+    return (uint32_t)offset;
+}
+
+VkDescriptorSetLayout getUniformRingLayout(VulkanContext* context) {
+    return context->uniformRing->setLayout;
+}
+
+void bindUniformRing(VulkanContext* context, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t offset) {
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &context->uniformRing->descriptorSet, 1, &offset);
+}
+
+void createBindlessTable(VulkanContext* context, uint32_t maxTextures, uint32_t maxBuffers) {
+    if (!context->features.descriptorIndexing) {
+        LOG(LOG_DEFAULT_UTILS, false, "descriptor indexing unsupported, bindless table disabled");
+        return;
+    }
+    VulkanBindlessTable* table = new VulkanBindlessTable {};
+    context->bindless = table;
+    table->capacity[BINDLESS_TEXTURES] = maxTextures;
+    table->capacity[BINDLESS_BUFFERS] = maxBuffers;
+
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = maxBuffers;
+    bindings[0].stageFlags = DESCRIPTOR_STAGES;
+    // the variable sized array has to be the last binding
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = maxTextures;
+    bindings[1].stageFlags = DESCRIPTOR_STAGES;
+    VkDescriptorBindingFlags bindingFlags[2] = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+    };
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+    bindingFlagsInfo.bindingCount = 2;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+    VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    VAC(vkCreateDescriptorSetLayout(context->device, &layoutInfo, 0, &table->setLayout));
+
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxBuffers },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxTextures }
+    };
+    VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    VAC(vkCreateDescriptorPool(context->device, &poolInfo, 0, &table->descriptorPool));
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+    variableCountInfo.descriptorSetCount = 1;
+    variableCountInfo.pDescriptorCounts = &maxTextures;
+    VkDescriptorSetAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    allocateInfo.pNext = &variableCountInfo;
+    allocateInfo.descriptorPool = table->descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &table->setLayout;
+    VAC(vkAllocateDescriptorSets(context->device, &allocateInfo, &table->descriptorSet));
+}
+
+void destroyBindlessTable(VulkanContext* context) {
+    VulkanBindlessTable* table = context->bindless;
+    if (!table) {
+        return;
+    }
+    vkDestroyDescriptorPool(context->device, table->descriptorPool, 0);
+    vkDestroyDescriptorSetLayout(context->device, table->setLayout, 0);
+    delete table;
+    context->bindless = nullptr;
+}
+
+uint32_t acquireBindlessSlot(VulkanBindlessTable* table, uint32_t kind) {
+    if (!table->freeSlots[kind].empty()) {
+        uint32_t slot = table->freeSlots[kind].back();
+        table->freeSlots[kind].pop_back();
+        return slot;
+    }
+    if (table->count[kind] == table->capacity[kind]) {
+        throw std::runtime_error("bindless table full!");
+    }
+    return table->count[kind]++;
+}
+
+uint32_t addBindlessTexture(VulkanContext* context, VkImageView imageView, VkSampler sampler) {
+    VulkanBindlessTable* table = context->bindless;
+    uint32_t slot = acquireBindlessSlot(table, BINDLESS_TEXTURES);
+
+    VkDescriptorImageInfo imageInfo = { sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    write.dstSet = table->descriptorSet;
+    write.dstBinding = 1;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(context->device, 1, &write, 0, 0);
+    return slot;
+}
+
+uint32_t addBindlessBuffer(VulkanContext* context, const VulkanBuffer& buffer) {
+    VulkanBindlessTable* table = context->bindless;
+    uint32_t slot = acquireBindlessSlot(table, BINDLESS_BUFFERS);
+
+    VkDescriptorBufferInfo bufferInfo = { buffer.buffer, 0, VK_WHOLE_SIZE };
+    VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    write.dstSet = table->descriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = slot;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context->device, 1, &write, 0, 0);
+    return slot;
+}
+
+void releaseBindlessTexture(VulkanContext* context, VulkanFrame& frame, uint32_t index) {
+    context->bindless->releasedSlots[BINDLESS_TEXTURES][frame.index].push_back(index);
+}
+
+void releaseBindlessBuffer(VulkanContext* context, VulkanFrame& frame, uint32_t index) {
+    context->bindless->releasedSlots[BINDLESS_BUFFERS][frame.index].push_back(index);
+}
+
+void retireBindlessSlots(VulkanContext* context, uint32_t frameIndex) {
+    VulkanBindlessTable* table = context->bindless;
+    if (!table) {
+        return;
+    }
+    for (uint32_t kind {0}; kind < 2; kind++) {
+        auto& released = table->releasedSlots[kind][frameIndex];
+        table->freeSlots[kind].insert(table->freeSlots[kind].end(), released.begin(), released.end());
+        released.clear();
+    }
+}
+
+VkDescriptorSetLayout getBindlessLayout(VulkanContext* context) {
+    return context->bindless ? context->bindless->setLayout : VK_NULL_HANDLE;
+}
+
+void bindBindlessTable(VulkanContext* context, VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) {
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &context->bindless->descriptorSet, 0, 0);
+}
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <atomic>
+#include "vulkan-base.h"
+#include "thread-pool.h"
+
+enum MeshLoadState {
+    MESH_LOAD_PENDING,
+    MESH_LOAD_READY,
+    MESH_LOAD_FAILED
+};
+
+struct VulkanMeshLoad {
+    std::string filename;
+    uint32_t mesh;
+    // only touched by the worker until the state leaves pending
+    VulkanMappedFile mapped;
+    std::string error;
+    std::atomic<uint32_t> state;
+};
+
+void createDrawList(VulkanContext* context, uint32_t maxVertices, uint32_t maxIndices, VulkanDrawList& drawList) {
+    drawList = {};
+    drawList.vertexCapacity = maxVertices;
+    drawList.indexCapacity = maxIndices;
+    // storage usage lets compute passes read the arenas directly
+    createBuffer(context, sizeof(PackedVertex) * (VkDeviceSize)maxVertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawList.vertexArena);
+    createBuffer(context, sizeof(uint32_t) * (VkDeviceSize)maxIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawList.indexArena);
+}
+
+void destroyDrawList(VulkanContext* context, VulkanDrawList& drawList) {
+    if (!drawList.loads.empty()) {
+        context->threadPool->wait();
+        for (VulkanMeshLoad* load : drawList.loads) {
+            if (load->mapped.data) {
+                unmapFile(load->mapped);
+            }
+            delete load;
+        }
+    }
+    destroyBuffer(context, drawList.vertexArena);
+    destroyBuffer(context, drawList.indexArena);
+    drawList = {};
+}
+
+uint32_t addMesh(VulkanContext* context, VulkanDrawList& drawList, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    if (drawList.vertexCount + vertices.size() > drawList.vertexCapacity || drawList.indexCount + indices.size() > drawList.indexCapacity) {
+        throw std::runtime_error("draw list arenas are full!");
+    }
+
+    VulkanMesh mesh;
+    mesh.firstIndex = drawList.indexCount;
+    mesh.indexCount = (uint32_t)indices.size();
+    mesh.vertexOffset = (int32_t)drawList.vertexCount;
+    mesh.lodCount = 1;
+    mesh.lods[0] = { mesh.firstIndex, mesh.indexCount, 0.0f };
+    mesh.radius = 0.0f;
+    for (auto& vertex : vertices) {
+        mesh.radius = std::max(mesh.radius, glm::length(vertex.position));
+    }
+
+    std::vector<PackedVertex> packed = packVertices(vertices);
+    uploadBuffer(context, drawList.vertexArena, sizeof(PackedVertex) * (VkDeviceSize)drawList.vertexCount, packed.data(), sizeof(PackedVertex) * packed.size());
+    uploadBuffer(context, drawList.indexArena, sizeof(uint32_t) * (VkDeviceSize)drawList.indexCount, indices.data(), sizeof(uint32_t) * indices.size());
+    drawList.vertexCount += (uint32_t)vertices.size();
+    drawList.indexCount += (uint32_t)indices.size();
+
+    drawList.meshes.push_back(mesh);
+    drawList.instances.emplace_back();
+    return (uint32_t)drawList.meshes.size() - 1;
+}
+
+// everything the arenas and the gpu rely on is checked here, the data itself is copied as is
+bool validateMeshFile(const VulkanMappedFile& mapped, std::string& error) {
+    if (mapped.size < sizeof(VulkanMeshFileHeader)) {
+        error = "too small for a header";
+        return false;
+    }
+    const VulkanMeshFileHeader* header = (const VulkanMeshFileHeader*)mapped.data;
+    if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION) {
+        error = "not a mesh file of version " + std::to_string(MESH_FILE_VERSION);
+        return false;
+    }
+    if (header->vertexStride != sizeof(PackedVertex)) {
+        error = "written for a different vertex format";
+        return false;
+    }
+    if (header->lodCount == 0 || header->lodCount > MAX_MESH_LODS) {
+        error = "invalid lod count";
+        return false;
+    }
+    uint64_t vertexBytes = (uint64_t)header->vertexCount * sizeof(PackedVertex);
+    uint64_t indexBytes = (uint64_t)header->indexCount * sizeof(uint32_t);
+    if (header->vertexOffset % MESH_FILE_ALIGNMENT != 0 || header->indexOffset % MESH_FILE_ALIGNMENT != 0
+        || header->vertexOffset > mapped.size || vertexBytes > mapped.size - header->vertexOffset
+        || header->indexOffset > mapped.size || indexBytes > mapped.size - header->indexOffset) {
+        error = "data out of bounds";
+        return false;
+    }
+    for (uint32_t i {0}; i < header->lodCount; i++) {
+        const VulkanMeshFileLod& lod = header->lods[i];
+        if (lod.indexCount % 3 != 0 || lod.firstIndex > header->indexCount || lod.indexCount > header->indexCount - lod.firstIndex) {
+            error = "lod " + std::to_string(i) + " out of bounds";
+            return false;
+        }
+    }
+    // out of range indices would read past the mesh in the arena, checking them also faults the index pages in
+    const uint32_t* indices = (const uint32_t*)(mapped.data + header->indexOffset);
+    for (uint32_t i {0}; i < header->indexCount; i++) {
+        if (indices[i] >= header->vertexCount) {
+            error = "index out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t requestMesh(VulkanContext* context, VulkanDrawList& drawList, const std::string& filename) {
+    drawList.meshes.push_back({});
+    drawList.instances.emplace_back();
+
+    VulkanMeshLoad* load = new VulkanMeshLoad {};
+    load->filename = filename;
+    load->mesh = (uint32_t)drawList.meshes.size() - 1;
+    load->state = MESH_LOAD_PENDING;
+    drawList.loads.push_back(load);
+
+    // the workers only block on the disk, so several files load in parallel at its bandwidth
+    context->threadPool->submit([load](uint32_t) {
+        if (!mapFile(load->filename, load->mapped)) {
+            load->error = "could not map the file";
+            load->state.store(MESH_LOAD_FAILED, std::memory_order_release);
+            return;
+        }
+        if (!validateMeshFile(load->mapped, load->error)) {
+            load->state.store(MESH_LOAD_FAILED, std::memory_order_release);
+            return;
+        }
+        const VulkanMeshFileHeader* header = (const VulkanMeshFileHeader*)load->mapped.data;
+        prefetchFile(load->mapped, (size_t)header->vertexOffset, (size_t)header->vertexCount * sizeof(PackedVertex));
+        load->state.store(MESH_LOAD_READY, std::memory_order_release);
+    });
+    return load->mesh;
+}
+
+uint32_t updateMeshStreaming(VulkanContext* context, VulkanDrawList& drawList, VkDeviceSize byteBudget) {
+    uint32_t resident {0};
+    VkDeviceSize uploaded {0};
+    for (auto it = drawList.loads.begin(); it != drawList.loads.end() && uploaded < byteBudget;) {
+        VulkanMeshLoad* load = *it;
+        uint32_t state = load->state.load(std::memory_order_acquire);
+        if (state == MESH_LOAD_PENDING) {
+            it++;
+            continue;
+        }
+
+        if (state == MESH_LOAD_READY) {
+            const VulkanMeshFileHeader* header = (const VulkanMeshFileHeader*)load->mapped.data;
+            if (drawList.vertexCount + header->vertexCount > drawList.vertexCapacity || drawList.indexCount + header->indexCount > drawList.indexCapacity) {
+                load->error = "draw list arenas are full";
+            } else {
+                // straight from the mapping into staging, the pages are already resident
+                VkDeviceSize vertexBytes = sizeof(PackedVertex) * (VkDeviceSize)header->vertexCount;
+                VkDeviceSize indexBytes = sizeof(uint32_t) * (VkDeviceSize)header->indexCount;
+                uploadBuffer(context, drawList.vertexArena, sizeof(PackedVertex) * (VkDeviceSize)drawList.vertexCount, load->mapped.data + header->vertexOffset, vertexBytes);
+                uploadBuffer(context, drawList.indexArena, sizeof(uint32_t) * (VkDeviceSize)drawList.indexCount, load->mapped.data + header->indexOffset, indexBytes);
+
+                VulkanMesh& mesh = drawList.meshes[load->mesh];
+                mesh.vertexOffset = (int32_t)drawList.vertexCount;
+                mesh.radius = header->radius;
+                mesh.lodCount = header->lodCount;
+                for (uint32_t i {0}; i < header->lodCount; i++) {
+                    mesh.lods[i] = { drawList.indexCount + header->lods[i].firstIndex, header->lods[i].indexCount, header->lods[i].error };
+                }
+                mesh.firstIndex = mesh.lods[0].firstIndex;
+                mesh.indexCount = mesh.lods[0].indexCount;
+                drawList.vertexCount += header->vertexCount;
+                drawList.indexCount += header->indexCount;
+                uploaded += vertexBytes + indexBytes;
+                resident++;
+            }
+        }
+        if (!load->error.empty()) {
+            LOG(LOG_ERROR_UTILS, false, "mesh-streaming: %s: %s", load->filename.c_str(), load->error.c_str());
+        }
+        if (load->mapped.data) {
+            unmapFile(load->mapped);
+        }
+        delete load;
+        it = drawList.loads.erase(it);
+    }
+    return resident;
+}
+
+void selectMeshLod(VulkanDrawList& drawList, uint32_t mesh, float maxError) {
+    VulkanMesh& selected = drawList.meshes[mesh];
+    uint32_t lod {0};
+    while (lod + 1 < selected.lodCount && selected.lods[lod + 1].error <= maxError) {
+        lod++;
+    }
+    if (selected.lodCount > 0) {
+        selected.firstIndex = selected.lods[lod].firstIndex;
+        selected.indexCount = selected.lods[lod].indexCount;
+    }
+}
+
+void addInstance(VulkanDrawList& drawList, uint32_t mesh, const Instance& instance) {
+    drawList.instances[mesh].push_back(instance);
+}
+
+void clearInstances(VulkanDrawList& drawList) {
+    for (auto& instances : drawList.instances) {
+        instances.clear();
+    }
+}
+
+void sortInstances(VulkanDrawList& drawList, const glm::vec3& cameraPosition) {
+    auto distance = [&](const Instance& instance) {
+        glm::vec3 offset = instance.position - cameraPosition;
+        return glm::dot(offset, offset);
+    };
+    for (auto& instances : drawList.instances) {
+        std::sort(instances.begin(), instances.end(), [&](const Instance& a, const Instance& b) {
+            return distance(a) < distance(b);
+        });
+    }
+}
+
+void prepareDrawList(VulkanContext* context, VulkanFrame& frame, VulkanDrawList& drawList) {
+    drawList.instanceCount = 0;
+    drawList.commandCount = 0;
+    for (auto& instances : drawList.instances) {
+        drawList.instanceCount += (uint32_t)instances.size();
+        drawList.commandCount += instances.empty() ? 0 : 1;
+    }
+
+    Instance* instanceData;
+    VkDrawIndexedIndirectCommand* commands;
+    uint32_t* count;
+    drawList.frameBuffer = frame.transientBuffer.buffer;
+    drawList.instanceOffset = allocateTransient(context, frame, sizeof(Instance) * (VkDeviceSize)std::max(1u, drawList.instanceCount), 16, (void**)&instanceData);
+    drawList.commandOffset = allocateTransient(context, frame, sizeof(VkDrawIndexedIndirectCommand) * (VkDeviceSize)std::max(1u, drawList.commandCount), 4, (void**)&commands);
+    drawList.countOffset = allocateTransient(context, frame, sizeof(uint32_t), 4, (void**)&count);
+
+    uint32_t firstInstance {0};
+    uint32_t command {0};
+    for (size_t i {0}; i < drawList.meshes.size(); i++) {
+        const std::vector<Instance>& instances = drawList.instances[i];
+        if (instances.empty()) {
+            continue;
+        }
+        memcpy(instanceData + firstInstance, instances.data(), sizeof(Instance) * instances.size());
+
+        const VulkanMesh& mesh = drawList.meshes[i];
+        // recordDrawList rebinds the instance stream per mesh when firstInstance is unsupported
+        uint32_t commandFirstInstance = context->features.drawIndirectFirstInstance ? firstInstance : 0;
+        commands[command++] = { mesh.indexCount, (uint32_t)instances.size(), mesh.firstIndex, mesh.vertexOffset, commandFirstInstance };
+        firstInstance += (uint32_t)instances.size();
+    }
+    *count = drawList.commandCount;
+}
+
+void recordDrawList(VulkanContext* context, VkCommandBuffer commandBuffer, const VulkanDrawList& drawList) {
+    if (drawList.commandCount == 0) {
+        return;
+    }
+
+    VkBuffer vertexBuffers[] = { drawList.vertexArena.buffer, drawList.frameBuffer };
+    VkDeviceSize offsets[] = { 0, drawList.instanceOffset };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, drawList.indexArena.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    const VulkanDeviceFeatures& features = context->features;
+    if (features.drawIndirectCount && features.drawIndirectFirstInstance) {
+        vkCmdDrawIndexedIndirectCount(commandBuffer, drawList.frameBuffer, drawList.commandOffset, drawList.frameBuffer, drawList.countOffset, drawList.commandCount, stride);
+    } else if (features.multiDrawIndirect && features.drawIndirectFirstInstance) {
+        vkCmdDrawIndexedIndirect(commandBuffer, drawList.frameBuffer, drawList.commandOffset, drawList.commandCount, stride);
+    } else {
+        // without firstInstance in indirect commands every mesh rebinds the instance stream at its own offset
+        VkDeviceSize instanceOffset = drawList.instanceOffset;
+        uint32_t command {0};
+        for (auto& instances : drawList.instances) {
+            if (instances.empty()) {
+                continue;
+            }
+            if (!features.drawIndirectFirstInstance) {
+                vkCmdBindVertexBuffers(commandBuffer, 1, 1, &drawList.frameBuffer, &instanceOffset);
+                instanceOffset += sizeof(Instance) * instances.size();
+            }
+            VkDeviceSize commandOffset = drawList.commandOffset + (VkDeviceSize)stride * command++;
+            vkCmdDrawIndexedIndirect(commandBuffer, drawList.frameBuffer, commandOffset, 1, stride);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+// its min and max macros would break std::min
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "vulkan-base.h"
+
+bool mapFile(const std::string& filename, VulkanMappedFile& mapped) {
+    mapped = {};
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    mapped.data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mapped.data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    mapped.size = (size_t)size.QuadPart;
+    mapped.file = file;
+    mapped.mapping = mapping;
+#else
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        return false;
+    }
+    void* data = mmap(0, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps the file alive on its own
+    close(file);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    mapped.data = (const uint8_t*)data;
+    mapped.size = (size_t)status.st_size;
+#endif
+    return true;
+}
+
+void unmapFile(VulkanMappedFile& mapped) {
+#ifdef _WIN32
+    UnmapViewOfFile(mapped.data);
+    CloseHandle((HANDLE)mapped.mapping);
+    CloseHandle((HANDLE)mapped.file);
+#else
+    munmap((void*)mapped.data, mapped.size);
+#endif
+    mapped = {};
+}
+
+// reads one byte per page, so the page faults happen on the calling thread instead of whoever copies the data later
+void prefetchFile(const VulkanMappedFile& mapped, size_t offset, size_t size) {
+    const size_t pageSize = 4096;
+    size = std::min(size, mapped.size - std::min(offset, mapped.size));
+#ifndef _WIN32
+    if (size > 0) {
+        uintptr_t start = ((uintptr_t)mapped.data + offset) & ~(uintptr_t)(pageSize - 1);
+        madvise((void*)start, (uintptr_t)mapped.data + offset + size - start, MADV_WILLNEED);
+    }
+#endif
+    volatile uint8_t sink {0};
+    for (size_t touched {0}; touched < size; touched += pageSize) {
+        sink = sink + mapped.data[offset + touched];
+    }
+    if (size > 0) {
+        sink = sink + mapped.data[offset + size - 1];
+    }
+}
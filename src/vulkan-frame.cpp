@@ -0,0 +1,126 @@
+#include "vulkan-base.h"
+
+void createFrames(VulkanContext* context, std::array<VulkanFrame, MAX_FRAMES_IN_FLIGHT>& frames) {
+    for (uint32_t i {0}; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VulkanFrame& frame = frames[i];
+        frame = {};
+        frame.index = i;
+        frame.gpuMilliseconds = -1.0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+        VAC(vkCreateSemaphore(context->device, &semaphoreInfo, 0, &frame.acquireSemaphore));
+        VAC(vkCreateSemaphore(context->device, &semaphoreInfo, 0, &frame.releaseSemaphore));
+
+        // no per-buffer reset flag, the whole pool is reset once the frame retired
+        VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = context->graphicsQueue.familyIndex;
+        VAC(vkCreateCommandPool(context->device, &poolInfo, 0, &frame.commandPool));
+
+        VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        allocateInfo.commandPool = frame.commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VAC(vkAllocateCommandBuffers(context->device, &allocateInfo, &frame.commandBuffer));
+
+        createDescriptorAllocator(context, FRAME_DESCRIPTOR_COUNT, frame.descriptors);
+
+        createBuffer(context, FRAME_TRANSIENT_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.transientBuffer);
+    }
+}
+
+void destroyFrames(VulkanContext* context, std::array<VulkanFrame, MAX_FRAMES_IN_FLIGHT>& frames) {
+    for (auto& frame : frames) {
+        destroyBuffer(context, frame.transientBuffer);
+        destroyDescriptorAllocator(context, frame.descriptors);
+        vkDestroyCommandPool(context->device, frame.commandPool, 0);
+        vkDestroySemaphore(context->device, frame.acquireSemaphore, 0);
+        vkDestroySemaphore(context->device, frame.releaseSemaphore, 0);
+    }
+}
+
+void waitFrame(VulkanContext* context, VulkanFrame& frame) {
+    beginCpuScope(context, "wait frame");
+    waitTimeline(context, context->graphicsQueue, frame.timelineValue);
+    endCpuScope(context);
+    frame.gpuMilliseconds = collectProfilerFrame(context, frame.index);
+    collectDeletions(context);
+    resetRecorder(context, frame.index);
+    retireBindlessSlots(context, frame.index);
+    retireUploads(context);
+}
+
+void beginFrame(VulkanContext* context, VulkanFrame& frame) {
+    VAC(vkResetCommandPool(context->device, frame.commandPool, 0));
+    resetDescriptorAllocator(context, frame.descriptors);
+    resetUniformRing(context, frame.index);
+    frame.transientOffset = 0;
+    frame.waitSemaphores.clear();
+    frame.waitStages.clear();
+    frame.waitValues.clear();
+
+    beginCpuScope(context, "flush uploads");
+    flushUploads(context);
+    endCpuScope(context);
+
+    VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VAC(vkBeginCommandBuffer(frame.commandBuffer, &beginInfo));
+    beginProfilerFrame(context, frame.index, frame.commandBuffer);
+
+    uint32_t scope = beginGpuScope(context, frame.index, frame.commandBuffer, "acquire uploads");
+    acquireUploads(context, frame);
+    endGpuScope(context, frame.index, frame.commandBuffer, scope);
+}
+
+void addFrameWait(VulkanFrame& frame, VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value) {
+    frame.waitSemaphores.push_back(semaphore);
+    frame.waitStages.push_back(stage);
+    frame.waitValues.push_back(value);
+}
+
+void submitFrame(VulkanContext* context, VulkanFrame& frame, bool signalRelease) {
+    endProfilerFrame(context, frame.index, frame.commandBuffer);
+    VAC(vkEndCommandBuffer(frame.commandBuffer));
+
+    VulkanQueue& queue = context->graphicsQueue;
+    uint64_t timelineValue = queue.submitted + 1;
+    VkSemaphore signalSemaphores[] = { queue.timeline, frame.releaseSemaphore };
+    uint64_t signalValues[] = { timelineValue, 0 };
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+    timelineInfo.waitSemaphoreValueCount = (uint32_t)frame.waitValues.size();
+    timelineInfo.pWaitSemaphoreValues = frame.waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalRelease ? 2 : 1;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    submitInfo.waitSemaphoreCount = (uint32_t)frame.waitSemaphores.size();
+    submitInfo.pWaitSemaphores = frame.waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = frame.waitStages.data();
+    submitInfo.signalSemaphoreCount = signalRelease ? 2 : 1;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+    VAC(vkQueueSubmit(queue.queue, 1, &submitInfo, VK_NULL_HANDLE));
+    queue.submitted = timelineValue;
+    frame.timelineValue = timelineValue;
+}
+
+VkDeviceSize allocateTransient(VulkanContext* context, VulkanFrame& frame, VkDeviceSize size, VkDeviceSize alignment, void** mapped) {
+    VkDeviceSize offset = (frame.transientOffset + alignment - 1) / alignment * alignment;
+    if (offset + size > frame.transientBuffer.size) {
+        throw std::runtime_error("frame transient buffer exhausted!");
+    }
+    frame.transientOffset = offset + size;
+    if (mapped) {
+        *mapped = (uint8_t*)frame.transientBuffer.allocation.mapped + offset;
+    }
+    return offset;
+}
+
+VkDescriptorSet allocateTransientDescriptorSet(VulkanContext* context, VulkanFrame& frame, VkDescriptorSetLayout layout) {
+    return allocateDescriptorSet(context, frame.descriptors, layout);
+}
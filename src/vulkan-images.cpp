@@ -0,0 +1,113 @@
+#include "vulkan-base.h"
+
+void createImage(VulkanContext* context, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VulkanImage& image) {
+    createImage(context, width, height, 1, format, usage, image);
+}
+
+void createImage(VulkanContext* context, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VulkanImage& image) {
+    image = {};
+    image.width = width;
+    image.height = height;
+    image.mipLevels = mipLevels;
+    image.format = format;
+
+    VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { width, height, 1 };
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VAC(vkCreateImage(context->device, &imageInfo, 0, &image.image));
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(context->device, image.image, &memRequirements);
+
+    allocateMemory(context, memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.allocation);
+    VAC(vkBindImageMemory(context->device, image.image, image.allocation.memory, image.allocation.offset));
+
+    VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.components = {};
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+    VAC(vkCreateImageView(context->device, &viewInfo, 0, &image.imageView));
+}
+
+void createAttachmentImage(VulkanContext* context, uint32_t width, uint32_t height, VkFormat format, VkSampleCountFlagBits samples, VulkanImage& image, VkImageUsageFlags usage) {
+    image = {};
+    image.width = width;
+    image.height = height;
+    image.mipLevels = 1;
+    image.format = format;
+
+    bool depth = isDepthFormat(format);
+    VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { width, height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = samples;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = (depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) | (usage != 0 ? usage : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VAC(vkCreateImage(context->device, &imageInfo, 0, &image.image));
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(context->device, image.image, &memRequirements);
+
+    // on tilers the contents never leave tile memory, so lazily allocated memory is never actually backed
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    if (usage != 0 || !hasMemoryType(context, memRequirements.memoryTypeBits, properties)) {
+        properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    }
+    allocateMemory(context, memRequirements, properties, image.allocation);
+    VAC(vkBindImageMemory(context->device, image.image, image.allocation.memory, image.allocation.offset));
+
+    VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.components = {};
+    viewInfo.subresourceRange = { (VkImageAspectFlags)(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+    VAC(vkCreateImageView(context->device, &viewInfo, 0, &image.imageView));
+}
+
+bool isDepthFormat(VkFormat format) {
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+VkFormat chooseDepthFormat(VulkanContext* context) {
+    for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(context->physicalDevice, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
+        }
+    }
+    throw std::runtime_error("failed to find a supported depth format!");
+}
+
+VkSampleCountFlagBits chooseSampleCount(VulkanContext* context, VkSampleCountFlagBits requested) {
+    const VkPhysicalDeviceLimits& limits = context->physicalDeviceProperties.limits;
+    VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+    uint32_t samples = requested;
+    while (samples > VK_SAMPLE_COUNT_1_BIT && !(supported & samples)) {
+        samples >>= 1;
+    }
+    return (VkSampleCountFlagBits)samples;
+}
+
+void destroyImage(VulkanContext* context, VulkanImage& image) {
+    vkDestroyImageView(context->device, image.imageView, 0);
+    vkDestroyImage(context->device, image.image, 0);
+    freeMemory(context, image.allocation);
+    image = {};
+}
@@ -0,0 +1,437 @@
+#include <mutex>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "vulkan-base.h"
+
+// two level segregated fit: the first level splits ranges by power of two,
+// the second level splits each power of two into 16 linear steps
+const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+const VkDeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+const uint32_t SL_INDEX_COUNT_LOG2 = 4;
+const uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+const uint32_t FL_INDEX_SHIFT = 8;
+const uint32_t FL_INDEX_COUNT = 64 - FL_INDEX_SHIFT + 1;
+const VkDeviceSize SMALL_RANGE_SIZE = 1ull << FL_INDEX_SHIFT;
+const VkDeviceSize MIN_RANGE_SIZE = 16;
+
+struct MemoryBlock;
+
+struct MemoryRange {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkDeviceSize alignment;
+    bool free;
+    MemoryRange* prevPhysical;
+    MemoryRange* nextPhysical;
+    MemoryRange* prevFree;
+    MemoryRange* nextFree;
+    MemoryBlock* block;
+};
+
+struct MemoryBlock {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    VkDeviceSize usedBytes;
+    uint32_t allocationCount;
+    uint32_t memoryTypeIndex;
+    void* mapped;
+    bool dedicated;
+    MemoryRange* firstRange;
+    uint64_t flBitmap;
+    uint32_t slBitmap[FL_INDEX_COUNT];
+    MemoryRange* freeLists[FL_INDEX_COUNT][SL_INDEX_COUNT];
+};
+
+struct VulkanAllocator {
+    std::mutex mutex;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize bufferImageGranularity;
+    std::vector<MemoryBlock*> blocks[VK_MAX_MEMORY_TYPES];
+};
+
+uint32_t findMsb(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (uint32_t)index;
+#else
+    return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+uint32_t findLsb(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void mappingInsert(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+    if (size < SMALL_RANGE_SIZE) {
+        fl = 0;
+        sl = (uint32_t)(size / (SMALL_RANGE_SIZE / SL_INDEX_COUNT));
+    } else {
+        uint32_t msb = findMsb(size);
+        fl = msb - FL_INDEX_SHIFT + 1;
+        sl = (uint32_t)(size >> (msb - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+    }
+}
+
+// rounds up to the next list so every range found there is big enough
+void mappingSearch(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+    if (size >= SMALL_RANGE_SIZE) {
+        size += (1ull << (findMsb(size) - SL_INDEX_COUNT_LOG2)) - 1;
+    } else {
+        size += SMALL_RANGE_SIZE / SL_INDEX_COUNT - 1;
+    }
+    mappingInsert(size, fl, sl);
+}
+
+void insertFreeRange(MemoryBlock* block, MemoryRange* range) {
+    uint32_t fl, sl;
+    mappingInsert(range->size, fl, sl);
+    range->free = true;
+    range->prevFree = nullptr;
+    range->nextFree = block->freeLists[fl][sl];
+    if (range->nextFree) {
+        range->nextFree->prevFree = range;
+    }
+    block->freeLists[fl][sl] = range;
+    block->flBitmap |= 1ull << fl;
+    block->slBitmap[fl] |= 1u << sl;
+}
+
+void removeFreeRange(MemoryBlock* block, MemoryRange* range) {
+    uint32_t fl, sl;
+    mappingInsert(range->size, fl, sl);
+    if (range->prevFree) {
+        range->prevFree->nextFree = range->nextFree;
+    } else {
+        block->freeLists[fl][sl] = range->nextFree;
+    }
+    if (range->nextFree) {
+        range->nextFree->prevFree = range->prevFree;
+    }
+    if (!block->freeLists[fl][sl]) {
+        block->slBitmap[fl] &= ~(1u << sl);
+        if (!block->slBitmap[fl]) {
+            block->flBitmap &= ~(1ull << fl);
+        }
+    }
+    range->free = false;
+    range->prevFree = nullptr;
+    range->nextFree = nullptr;
+}
+
+MemoryRange* findFreeRange(MemoryBlock* block, uint32_t fl, uint32_t sl) {
+    if (fl >= FL_INDEX_COUNT) {
+        return nullptr;
+    }
+    uint32_t slMap = block->slBitmap[fl] & (~0u << sl);
+    if (!slMap) {
+        uint64_t flMap = fl + 1 < 64 ? block->flBitmap & (~0ull << (fl + 1)) : 0;
+        if (!flMap) {
+            return nullptr;
+        }
+        fl = findLsb(flMap);
+        slMap = block->slBitmap[fl];
+    }
+    sl = findLsb(slMap);
+    return block->freeLists[fl][sl];
+}
+
+MemoryRange* splitRange(MemoryBlock* block, MemoryRange* range, VkDeviceSize size) {
+    MemoryRange* tail = new MemoryRange {};
+    tail->offset = range->offset + size;
+    tail->size = range->size - size;
+    tail->block = block;
+    tail->prevPhysical = range;
+    tail->nextPhysical = range->nextPhysical;
+    if (tail->nextPhysical) {
+        tail->nextPhysical->prevPhysical = tail;
+    }
+    range->nextPhysical = tail;
+    range->size = size;
+    return tail;
+}
+
+void mergeWithNext(MemoryRange* range) {
+    MemoryRange* next = range->nextPhysical;
+    range->size += next->size;
+    range->nextPhysical = next->nextPhysical;
+    if (range->nextPhysical) {
+        range->nextPhysical->prevPhysical = range;
+    }
+    delete next;
+}
+
+MemoryBlock* createBlock(VulkanContext* context, uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) {
+    MemoryBlock* block = new MemoryBlock {};
+    block->size = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->dedicated = dedicated;
+
+    VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    VkResult result = vkAllocateMemory(context->device, &allocInfo, 0, &block->memory);
+    if (result != VK_SUCCESS) {
+        delete block;
+        VAC(result);
+        return nullptr;
+    }
+
+    VkMemoryPropertyFlags propertyFlags = context->allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    if (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        VAC(vkMapMemory(context->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+    }
+
+    block->firstRange = new MemoryRange {};
+    block->firstRange->size = size;
+    block->firstRange->block = block;
+    insertFreeRange(block, block->firstRange);
+
+    context->allocator->blocks[memoryTypeIndex].push_back(block);
+
+    uint32_t blockCount {0};
+    for (auto& blocks : context->allocator->blocks) {
+        blockCount += (uint32_t)blocks.size();
+    }
+    if (blockCount > context->physicalDeviceProperties.limits.maxMemoryAllocationCount) {
+        LOG(LOG_ERROR_UTILS, false, "memory block count %u exceeds maxMemoryAllocationCount", blockCount);
+    }
+    return block;
+}
+
+void destroyBlock(VulkanContext* context, MemoryBlock* block) {
+    auto& blocks = context->allocator->blocks[block->memoryTypeIndex];
+    blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+
+    if (block->mapped) {
+        vkUnmapMemory(context->device, block->memory);
+    }
+    vkFreeMemory(context->device, block->memory, 0);
+
+    MemoryRange* range = block->firstRange;
+    while (range) {
+        MemoryRange* next = range->nextPhysical;
+        delete range;
+        range = next;
+    }
+    delete block;
+}
+
+// carves the allocation out of a free range big enough for size plus its alignment padding
+void allocateFromRange(MemoryBlock* block, MemoryRange* range, VkDeviceSize size, VkDeviceSize alignment, VulkanAllocation& allocation) {
+    removeFreeRange(block, range);
+
+    VkDeviceSize padding = alignUp(range->offset, alignment) - range->offset;
+    if (padding > 0) {
+        MemoryRange* aligned = splitRange(block, range, padding);
+        insertFreeRange(block, range);
+        range = aligned;
+    }
+    if (range->size - size >= MIN_RANGE_SIZE) {
+        insertFreeRange(block, splitRange(block, range, size));
+    }
+
+    range->alignment = alignment;
+    block->usedBytes += range->size;
+    block->allocationCount++;
+
+    allocation = {};
+    allocation.memory = block->memory;
+    allocation.offset = range->offset;
+    allocation.size = range->size;
+    allocation.mapped = block->mapped ? (uint8_t*)block->mapped + range->offset : nullptr;
+    allocation.memoryTypeIndex = block->memoryTypeIndex;
+    allocation.handle = range;
+}
+
+bool allocateFromBlock(MemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment, VulkanAllocation& allocation) {
+    uint32_t fl, sl;
+    mappingSearch(size + alignment - 1, fl, sl);
+    MemoryRange* range = findFreeRange(block, fl, sl);
+    if (!range) {
+        return false;
+    }
+    allocateFromRange(block, range, size, alignment, allocation);
+    return true;
+}
+
+// keeps a single empty block per memory type around so alloc/free pairs don't thrash vkAllocateMemory
+void releaseRange(VulkanContext* context, MemoryRange* range) {
+    MemoryBlock* block = range->block;
+    block->usedBytes -= range->size;
+    block->allocationCount--;
+
+    if (range->prevPhysical && range->prevPhysical->free) {
+        MemoryRange* prev = range->prevPhysical;
+        removeFreeRange(block, prev);
+        mergeWithNext(prev);
+        range = prev;
+    }
+    if (range->nextPhysical && range->nextPhysical->free) {
+        removeFreeRange(block, range->nextPhysical);
+        mergeWithNext(range);
+    }
+    insertFreeRange(block, range);
+
+    if (block->allocationCount > 0) {
+        return;
+    }
+    if (block->dedicated) {
+        destroyBlock(context, block);
+        return;
+    }
+    for (MemoryBlock* other : context->allocator->blocks[block->memoryTypeIndex]) {
+        if (other != block && !other->dedicated && other->allocationCount == 0) {
+            destroyBlock(context, block);
+            return;
+        }
+    }
+}
+
+VkDeviceSize preferredBlockSize(VulkanAllocator* allocator, uint32_t memoryTypeIndex) {
+    uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapSize = allocator->memoryProperties.memoryHeaps[heapIndex].size;
+    return heapSize <= SMALL_HEAP_SIZE ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+}
+
+void createAllocator(VulkanContext* context) {
+    context->allocator = new VulkanAllocator {};
+    vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &context->allocator->memoryProperties);
+    context->allocator->bufferImageGranularity = context->physicalDeviceProperties.limits.bufferImageGranularity;
+}
+
+void destroyAllocator(VulkanContext* context) {
+    for (auto& blocks : context->allocator->blocks) {
+        while (!blocks.empty()) {
+            if (blocks.back()->allocationCount > 0) {
+                LOG(LOG_ERROR_UTILS, false, "memory block destroyed with %u live allocations", blocks.back()->allocationCount);
+            }
+            destroyBlock(context, blocks.back());
+        }
+    }
+    delete context->allocator;
+    context->allocator = nullptr;
+}
+
+void allocateMemory(VulkanContext* context, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, VulkanAllocation& allocation) {
+    VulkanAllocator* allocator = context->allocator;
+    std::lock_guard<std::mutex> lock(allocator->mutex);
+
+    uint32_t memoryTypeIndex = findMemoryType(context, requirements.memoryTypeBits, properties);
+
+    // aligning every range to the granularity keeps linear and optimal resources off shared pages
+    VkDeviceSize alignment = std::max(requirements.alignment, allocator->bufferImageGranularity);
+    VkDeviceSize size = alignUp(requirements.size, alignment);
+    VkDeviceSize blockSize = preferredBlockSize(allocator, memoryTypeIndex);
+
+    if (size > blockSize / 2) {
+        // the search rounds up to the next bucket, which a block of exactly this size is never in
+        MemoryBlock* block = createBlock(context, memoryTypeIndex, size, true);
+        allocateFromRange(block, block->firstRange, size, 1, allocation);
+        return;
+    }
+
+    for (MemoryBlock* block : allocator->blocks[memoryTypeIndex]) {
+        if (!block->dedicated && block->size - block->usedBytes >= size && allocateFromBlock(block, size, alignment, allocation)) {
+            return;
+        }
+    }
+
+    MemoryBlock* block = createBlock(context, memoryTypeIndex, blockSize, false);
+    if (!allocateFromBlock(block, size, alignment, allocation)) {
+        throw std::runtime_error("failed to sub-allocate from a fresh memory block!");
+    }
+}
+
+void freeMemory(VulkanContext* context, VulkanAllocation& allocation) {
+    if (!allocation.handle) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(context->allocator->mutex);
+    releaseRange(context, (MemoryRange*)allocation.handle);
+    allocation = {};
+}
+
+void getMemoryStats(VulkanContext* context, VulkanMemoryStats& stats) {
+    std::lock_guard<std::mutex> lock(context->allocator->mutex);
+    stats = {};
+    VkDeviceSize freeBytes {0};
+    for (auto& blocks : context->allocator->blocks) {
+        for (MemoryBlock* block : blocks) {
+            stats.blockCount++;
+            stats.allocationCount += block->allocationCount;
+            stats.reservedBytes += block->size;
+            stats.usedBytes += block->usedBytes;
+            for (MemoryRange* range = block->firstRange; range; range = range->nextPhysical) {
+                if (range->free) {
+                    freeBytes += range->size;
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, range->size);
+                }
+            }
+        }
+    }
+    stats.fragmentation = freeBytes > 0 ? 1.0f - (float)stats.largestFreeRange / (float)freeBytes : 0.0f;
+}
+
+void logMemoryStats(VulkanContext* context) {
+    VulkanMemoryStats stats;
+    getMemoryStats(context, stats);
+    LOG(LOG_DEFAULT_UTILS, false, "memory: %u blocks, %u allocations, %llu/%llu bytes used, fragmentation %.2f",
+        stats.blockCount, stats.allocationCount, (unsigned long long)stats.usedBytes, (unsigned long long)stats.reservedBytes, stats.fragmentation);
+}
+
+// moves allocations out of the emptiest blocks into fuller ones so the emptied blocks can be released
+uint32_t defragmentMemory(VulkanContext* context, std::vector<VulkanAllocation*>& allocations, const VulkanDefragmentationMove& move) {
+    VulkanAllocator* allocator = context->allocator;
+    uint32_t moved {0};
+
+    for (VulkanAllocation* allocation : allocations) {
+        VulkanAllocation destination {};
+        {
+            std::lock_guard<std::mutex> lock(allocator->mutex);
+            MemoryRange* range = (MemoryRange*)allocation->handle;
+            MemoryBlock* source = range->block;
+            if (source->dedicated) {
+                continue;
+            }
+
+            std::vector<MemoryBlock*> candidates;
+            for (MemoryBlock* block : allocator->blocks[source->memoryTypeIndex]) {
+                if (!block->dedicated && block->usedBytes > source->usedBytes) {
+                    candidates.push_back(block);
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](MemoryBlock* a, MemoryBlock* b) { return a->usedBytes > b->usedBytes; });
+
+            bool found = false;
+            for (MemoryBlock* block : candidates) {
+                if (allocateFromBlock(block, allocation->size, range->alignment, destination)) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                continue;
+            }
+        }
+
+        move(*allocation, destination);
+        freeMemory(context, *allocation);
+        *allocation = destination;
+        moved++;
+    }
+    return moved;
+}
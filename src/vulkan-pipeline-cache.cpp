@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <filesystem>
+#include "vulkan-base.h"
+
+const uint32_t PIPELINE_CACHE_MAGIC = 0x43505643; // "CVPC"
+const uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+// prefixed to the driver blob so a file from another device, driver or a torn write is never handed to vulkan
+struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t checksum;
+};
+
+uint64_t hashPipelineCacheData(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i {0}; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool isPipelineCacheCompatible(VulkanContext* context, const PipelineCacheFileHeader& header, const std::vector<uint8_t>& data) {
+    const VkPhysicalDeviceProperties& properties = context->physicalDeviceProperties;
+    if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_FILE_VERSION) {
+        return false;
+    }
+    if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID || header.driverVersion != properties.driverVersion) {
+        return false;
+    }
+    if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return false;
+    }
+    if (header.checksum != hashPipelineCacheData(data.data(), data.size())) {
+        return false;
+    }
+
+    // the driver writes its own header as well, it has to agree with ours
+    VkPipelineCacheHeaderVersionOne driverHeader;
+    if (data.size() < sizeof(driverHeader)) {
+        return false;
+    }
+    memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && driverHeader.vendorID == properties.vendorID
+        && driverHeader.deviceID == properties.deviceID
+        && memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+std::vector<uint8_t> readPipelineCacheFile(VulkanContext* context, const char* filename) {
+    std::vector<uint8_t> data;
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return data;
+    }
+
+    PipelineCacheFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.dataSize <= (64ull << 20)) {
+        data.resize((size_t)header.dataSize);
+        if (fread(data.data(), 1, data.size(), file) != data.size() || !isPipelineCacheCompatible(context, header, data)) {
+            data.clear();
+        }
+    }
+    fclose(file);
+
+    if (data.empty()) {
+        LOG(LOG_DEFAULT_UTILS, false, "pipeline-cache: discarding stale or corrupt %s", filename);
+    }
+    return data;
+}
+
+void createPipelineCache(VulkanContext* context, const char* filename) {
+    std::vector<uint8_t> data = readPipelineCacheFile(context, filename);
+
+    VkPipelineCacheCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+    VAC(vkCreatePipelineCache(context->device, &createInfo, 0, &context->pipelineCache));
+
+    context->pipelineCacheStats = {};
+    context->pipelineCacheStats.warm = !data.empty();
+    context->pipelineCacheStats.loadedBytes = data.size();
+    context->pipelineCacheFilename = filename;
+    LOG(LOG_DEFAULT_UTILS, false, "pipeline-cache: %s (%zu bytes)", data.empty() ? "cold" : "warm", data.size());
+}
+
+// written next to the target and renamed over it, so readers only ever see a complete file
+void savePipelineCache(VulkanContext* context) {
+    size_t size {0};
+    VAC(vkGetPipelineCacheData(context->device, context->pipelineCache, &size, 0));
+    std::vector<uint8_t> data(size);
+    VAC(vkGetPipelineCacheData(context->device, context->pipelineCache, &size, data.data()));
+    data.resize(size);
+
+    const VkPhysicalDeviceProperties& properties = context->physicalDeviceProperties;
+    PipelineCacheFileHeader header = {};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_FILE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.checksum = hashPipelineCacheData(data.data(), data.size());
+
+    std::string temporaryFilename = context->pipelineCacheFilename + ".tmp";
+    FILE* file = fopen(temporaryFilename.c_str(), "wb");
+    if (!file) {
+        LOG(LOG_ERROR_UTILS, false, "pipeline-cache: could not write %s", temporaryFilename.c_str());
+        return;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data.data(), 1, data.size(), file) == data.size();
+    written &= fflush(file) == 0;
+    written &= fclose(file) == 0;
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryFilename, context->pipelineCacheFilename, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryFilename, error);
+        LOG(LOG_ERROR_UTILS, false, "pipeline-cache: could not replace %s", context->pipelineCacheFilename.c_str());
+    }
+}
+
+void destroyPipelineCache(VulkanContext* context) {
+    savePipelineCache(context);
+    vkDestroyPipelineCache(context->device, context->pipelineCache, 0);
+    context->pipelineCache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,163 @@
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "vulkan-base.h"
+#include "thread-pool.h"
+
+enum PipelineState {
+    PIPELINE_PENDING,
+    PIPELINE_READY,
+    PIPELINE_FAILED
+};
+
+struct PipelineEntry {
+    VulkanPipelineDescription description;
+    VulkanPipeline pipeline;
+    std::atomic<int> state {PIPELINE_PENDING};
+    // rebuilt after a shader changed, swapped in by the next request once it finished
+    PipelineEntry* replacement {nullptr};
+    // the shader changed again while the replacement was compiling
+    bool reloadAgain {false};
+};
+
+// evicted entries are deleted through the deletion queue, so pointers handed out stay valid for the frame that got them
+struct VulkanPipelineRegistry {
+    std::mutex mutex;
+    std::unordered_multimap<uint64_t, PipelineEntry*> entries;
+};
+
+void compilePipelineEntry(VulkanContext* context, PipelineEntry* entry) {
+    context->threadPool->submit([context, entry](uint32_t) {
+        try {
+            createPipeline(context, entry->description, entry->pipeline);
+            entry->state.store(PIPELINE_READY, std::memory_order_release);
+        } catch(std::exception& exception) {
+            LOG(LOG_ERROR_UTILS, false, "pipeline-registry: %s + %s failed: %s", entry->description.vertexShader.c_str(), entry->description.fragmentShader.c_str(), exception.what());
+            entry->state.store(PIPELINE_FAILED, std::memory_order_release);
+        }
+    });
+}
+
+void deletePipelineEntry(VulkanContext* context, PipelineEntry* entry) {
+    if (entry->state.load() == PIPELINE_READY) {
+        destroyPipeline(context, &entry->pipeline);
+    }
+    delete entry;
+}
+
+void createPipelineRegistry(VulkanContext* context) {
+    context->pipelineRegistry = new VulkanPipelineRegistry {};
+}
+
+void destroyPipelineRegistry(VulkanContext* context) {
+    VulkanPipelineRegistry* registry = context->pipelineRegistry;
+    waitPipelines(context);
+
+    for (auto& [hash, entry] : registry->entries) {
+        if (entry->replacement) {
+            deletePipelineEntry(context, entry->replacement);
+        }
+        deletePipelineEntry(context, entry);
+    }
+
+    delete registry;
+    context->pipelineRegistry = nullptr;
+}
+
+const VulkanPipeline* requestPipeline(VulkanContext* context, const VulkanPipelineDescription& description) {
+    VulkanPipelineRegistry* registry = context->pipelineRegistry;
+    uint64_t hash = hashPipelineDescription(description);
+
+    PipelineEntry* entry = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(registry->mutex);
+        auto range = registry->entries.equal_range(hash);
+        auto it = range.first;
+        for (; it != range.second; it++) {
+            if (it->second->description == description) {
+                entry = it->second;
+                break;
+            }
+        }
+        if (!entry) {
+            entry = new PipelineEntry {};
+            entry->description = description;
+            registry->entries.emplace(hash, entry);
+            compilePipelineEntry(context, entry);
+        } else if (entry->replacement && entry->state.load(std::memory_order_acquire) != PIPELINE_PENDING
+            && entry->replacement->state.load(std::memory_order_acquire) != PIPELINE_PENDING) {
+            PipelineEntry* replacement = entry->replacement;
+            entry->replacement = nullptr;
+            // a broken edit keeps the last working pipeline on screen
+            if (replacement->state.load() == PIPELINE_READY || entry->state.load() != PIPELINE_READY) {
+                it->second = replacement;
+                deferDeletion(context, [context, entry]() {
+                    deletePipelineEntry(context, entry);
+                });
+                if (entry->reloadAgain) {
+                    replacement->replacement = new PipelineEntry {};
+                    replacement->replacement->description = description;
+                    compilePipelineEntry(context, replacement->replacement);
+                }
+                entry = replacement;
+            } else {
+                deletePipelineEntry(context, replacement);
+                entry->reloadAgain = false;
+            }
+        }
+    }
+
+    return entry->state.load(std::memory_order_acquire) == PIPELINE_READY ? &entry->pipeline : nullptr;
+}
+
+void waitPipelines(VulkanContext* context) {
+    context->threadPool->wait();
+}
+
+bool evictPipeline(VulkanContext* context, const VulkanPipelineDescription& description) {
+    VulkanPipelineRegistry* registry = context->pipelineRegistry;
+    uint64_t hash = hashPipelineDescription(description);
+
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    auto range = registry->entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; it++) {
+        PipelineEntry* entry = it->second;
+        if (!(entry->description == description)) {
+            continue;
+        }
+        int state = entry->state.load(std::memory_order_acquire);
+        if (state == PIPELINE_PENDING || (entry->replacement && entry->replacement->state.load(std::memory_order_acquire) == PIPELINE_PENDING)) {
+            return false;
+        }
+        registry->entries.erase(it);
+        deferDeletion(context, [context, entry]() {
+            if (entry->replacement) {
+                deletePipelineEntry(context, entry->replacement);
+            }
+            deletePipelineEntry(context, entry);
+        });
+        return true;
+    }
+    return true;
+}
+
+uint32_t reloadPipelines(VulkanContext* context, const std::string& shaderFilename) {
+    VulkanPipelineRegistry* registry = context->pipelineRegistry;
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    uint32_t count {0};
+    for (auto& [hash, entry] : registry->entries) {
+        if (entry->description.vertexShader != shaderFilename && entry->description.fragmentShader != shaderFilename) {
+            continue;
+        }
+        count++;
+        // the replacement may already have loaded the old code, it is rebuilt once more after it landed
+        if (entry->replacement) {
+            entry->reloadAgain = true;
+            continue;
+        }
+        entry->replacement = new PipelineEntry {};
+        entry->replacement->description = entry->description;
+        compilePipelineEntry(context, entry->replacement);
+    }
+    return count;
+}
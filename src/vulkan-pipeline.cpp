@@ -1,86 +1,261 @@
+#include <chrono>
+#include <mutex>
+#include <algorithm>
 #include "vulkan-base.h"
 
-VkShaderModule createShaderModule(VulkanContext* context, const char* shaderFilename) {
-    VkShaderModule result = {};
+std::mutex pipelineStatsMutex;
 
-    FILE* file = fopen(shaderFilename, "rb");
-    if (!file)
-    {
-        LOG(LOG_ERROR_UTILS, "shader not found: %s", shaderFilename);
-        return result;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long fileSize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    uint8_t* buffer = new uint8_t[fileSize];
-    fread(buffer, 1, fileSize, file);
-    VkShaderModuleCreateInfo createInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-    createInfo.codeSize = fileSize;
-    createInfo.pCode = (uint32_t*)buffer;
-    VAC(vkCreateShaderModule(context->device, &createInfo, 0, &result));
-    delete[] buffer;
-    fclose(file);
-    return result;
+// gives the shader modules back to the library however pipeline creation ends, a failed hot reload throws
+struct AcquiredShaderModules {
+    VulkanContext* context;
+    std::vector<VkShaderModule> modules;
+
+    VkShaderModule acquire(const std::string& filename, VulkanShaderReflection* reflection = nullptr) {
+        modules.reserve(modules.size() + 1);
+        modules.push_back(acquireShaderModule(context, filename, reflection));
+        return modules.back();
+    }
+
+    ~AcquiredShaderModules() {
+        for (VkShaderModule module : modules) {
+            releaseShaderModule(context, module);
+        }
+    }
+};
+
+void hashCombine(uint64_t& hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i {0}; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+// fields are hashed one by one, struct padding would make whole-struct hashes unstable
+uint64_t hashPipelineDescription(const VulkanPipelineDescription& description) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashCombine(hash, description.vertexShader.data(), description.vertexShader.size() + 1);
+    hashCombine(hash, description.fragmentShader.data(), description.fragmentShader.size() + 1);
+    for (auto& binding : description.bindings) {
+        hashCombine(hash, &binding.binding, sizeof(binding.binding));
+        hashCombine(hash, &binding.stride, sizeof(binding.stride));
+        hashCombine(hash, &binding.inputRate, sizeof(binding.inputRate));
+    }
+    for (auto& attribute : description.attributes) {
+        hashCombine(hash, &attribute.location, sizeof(attribute.location));
+        hashCombine(hash, &attribute.binding, sizeof(attribute.binding));
+        hashCombine(hash, &attribute.format, sizeof(attribute.format));
+        hashCombine(hash, &attribute.offset, sizeof(attribute.offset));
+    }
+    hashCombine(hash, &description.topology, sizeof(description.topology));
+    hashCombine(hash, &description.polygonMode, sizeof(description.polygonMode));
+    hashCombine(hash, &description.cullMode, sizeof(description.cullMode));
+    hashCombine(hash, &description.frontFace, sizeof(description.frontFace));
+    hashCombine(hash, &description.blendEnable, sizeof(description.blendEnable));
+    hashCombine(hash, &description.srcColorBlendFactor, sizeof(description.srcColorBlendFactor));
+    hashCombine(hash, &description.dstColorBlendFactor, sizeof(description.dstColorBlendFactor));
+    hashCombine(hash, &description.colorBlendOp, sizeof(description.colorBlendOp));
+    hashCombine(hash, &description.renderPass, sizeof(description.renderPass));
+    hashCombine(hash, &description.subpass, sizeof(description.subpass));
+    hashCombine(hash, &description.colorFormat, sizeof(description.colorFormat));
+    hashCombine(hash, &description.depthFormat, sizeof(description.depthFormat));
+    hashCombine(hash, &description.samples, sizeof(description.samples));
+    hashCombine(hash, &description.depthTest, sizeof(description.depthTest));
+    hashCombine(hash, &description.depthWrite, sizeof(description.depthWrite));
+    hashCombine(hash, &description.depthCompareOp, sizeof(description.depthCompareOp));
+    for (auto& setLayout : description.setLayouts) {
+        hashCombine(hash, &setLayout, sizeof(setLayout));
+    }
+    for (auto& range : description.pushConstants) {
+        hashCombine(hash, &range.stageFlags, sizeof(range.stageFlags));
+        hashCombine(hash, &range.offset, sizeof(range.offset));
+        hashCombine(hash, &range.size, sizeof(range.size));
+    }
+    for (auto& constant : description.specializationConstants) {
+        hashCombine(hash, &constant.first, sizeof(constant.first));
+        hashCombine(hash, &constant.second, sizeof(constant.second));
+    }
+    return hash;
+}
+
+bool operator==(const VulkanPipelineDescription& a, const VulkanPipelineDescription& b) {
+    auto sameBinding = [](const VkVertexInputBindingDescription& x, const VkVertexInputBindingDescription& y) {
+        return x.binding == y.binding && x.stride == y.stride && x.inputRate == y.inputRate;
+    };
+    auto sameAttribute = [](const VkVertexInputAttributeDescription& x, const VkVertexInputAttributeDescription& y) {
+        return x.location == y.location && x.binding == y.binding && x.format == y.format && x.offset == y.offset;
+    };
+    auto samePushConstants = [](const VkPushConstantRange& x, const VkPushConstantRange& y) {
+        return x.stageFlags == y.stageFlags && x.offset == y.offset && x.size == y.size;
+    };
+    return a.vertexShader == b.vertexShader && a.fragmentShader == b.fragmentShader
+        && std::equal(a.bindings.begin(), a.bindings.end(), b.bindings.begin(), b.bindings.end(), sameBinding)
+        && std::equal(a.attributes.begin(), a.attributes.end(), b.attributes.begin(), b.attributes.end(), sameAttribute)
+        && a.topology == b.topology && a.polygonMode == b.polygonMode && a.cullMode == b.cullMode && a.frontFace == b.frontFace
+        && a.blendEnable == b.blendEnable && a.srcColorBlendFactor == b.srcColorBlendFactor
+        && a.dstColorBlendFactor == b.dstColorBlendFactor && a.colorBlendOp == b.colorBlendOp
+        && a.renderPass == b.renderPass && a.subpass == b.subpass && a.colorFormat == b.colorFormat && a.depthFormat == b.depthFormat
+        && a.samples == b.samples && a.depthTest == b.depthTest && a.depthWrite == b.depthWrite && a.depthCompareOp == b.depthCompareOp
+        && a.setLayouts == b.setLayouts
+        && std::equal(a.pushConstants.begin(), a.pushConstants.end(), b.pushConstants.begin(), b.pushConstants.end(), samePushConstants)
+        && a.specializationConstants == b.specializationConstants;
+}
+
+VulkanPipelineDescription defaultPipelineDescription(const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass) {
+    VulkanPipelineDescription description;
+    description.vertexShader = vertexShaderFilename;
+    description.fragmentShader = fragmentShaderFilename;
+    // the buffers hold packed vertices, reflection would describe the shader's 32 bit inputs
+    description.bindings = { PackedVertex::getBindingDescription() };
+    auto attributeDescriptions = PackedVertex::getAttributeDescription();
+    description.attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+    description.renderPass = renderPass;
+    return description;
+}
+
+VulkanPipelineDescription defaultPipelineDescription(const char* vertexShaderFilename, const char* fragmentShaderFilename, VkFormat colorFormat) {
+    VulkanPipelineDescription description = defaultPipelineDescription(vertexShaderFilename, fragmentShaderFilename, VK_NULL_HANDLE);
+    description.colorFormat = colorFormat;
+    return description;
+}
+
+// the description's values for the constants the stage declares, data has to outlive the info
+void buildSpecializationInfo(const VulkanShaderReflection& reflection, const std::vector<std::pair<uint32_t, uint32_t>>& constants,
+    std::vector<VkSpecializationMapEntry>& entries, std::vector<uint32_t>& data, VkSpecializationInfo& info) {
+    for (auto& [id, value] : constants) {
+        auto declared = std::find_if(reflection.specializationConstants.begin(), reflection.specializationConstants.end(), [&](const std::pair<uint32_t, uint32_t>& constant) {
+            return constant.first == id;
+        });
+        if (declared == reflection.specializationConstants.end()) {
+            continue;
+        }
+        if (declared->second != sizeof(uint32_t)) {
+            throw std::runtime_error("only 32 bit specialization constants are supported!");
+        }
+        entries.push_back({ id, (uint32_t)(data.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+        data.push_back(value);
+    }
+    info = {};
+    info.mapEntryCount = (uint32_t)entries.size();
+    info.pMapEntries = entries.data();
+    info.dataSize = data.size() * sizeof(uint32_t);
+    info.pData = data.data();
 }
 
 void createPipeline(VulkanContext* context, const char* vertexShaderFilename, const char* fragmentShaderFilename, VkRenderPass renderPass, uint32_t width, uint32_t height, VulkanPipeline& pipeline) {
-    VkShaderModule vertexShaderModule = createShaderModule(context, vertexShaderFilename);
-    VkShaderModule fragmentShaderModule = createShaderModule(context, fragmentShaderFilename);
+    createPipeline(context, defaultPipelineDescription(vertexShaderFilename, fragmentShaderFilename, renderPass), pipeline);
+}
+
+// safe to call from several threads at once, the pipeline cache is internally synchronized
+void createPipeline(VulkanContext* context, const VulkanPipelineDescription& description, VulkanPipeline& pipeline) {
+    // without a fragment shader the pipeline only writes depth, e.g. for a depth prepass
+    bool hasFragmentShader = !description.fragmentShader.empty();
+    VulkanShaderReflection vertexReflection;
+    VulkanShaderReflection fragmentReflection;
+    AcquiredShaderModules shaderModules { context };
+    VkShaderModule vertexShaderModule = shaderModules.acquire(description.vertexShader, &vertexReflection);
+    VkShaderModule fragmentShaderModule = hasFragmentShader ? shaderModules.acquire(description.fragmentShader, &fragmentReflection) : VK_NULL_HANDLE;
+
+    std::vector<VkSpecializationMapEntry> vertexEntries, fragmentEntries;
+    std::vector<uint32_t> vertexData, fragmentData;
+    VkSpecializationInfo vertexSpecialization, fragmentSpecialization;
+    buildSpecializationInfo(vertexReflection, description.specializationConstants, vertexEntries, vertexData, vertexSpecialization);
+    buildSpecializationInfo(fragmentReflection, description.specializationConstants, fragmentEntries, fragmentData, fragmentSpecialization);
 
     std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
-    shaderStages.resize(2);
+    shaderStages.resize(hasFragmentShader ? 2 : 1);
     shaderStages[0] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
     shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
     shaderStages[0].module = vertexShaderModule;
     shaderStages[0].pName = "main";
+    shaderStages[0].pSpecializationInfo = vertexEntries.empty() ? nullptr : &vertexSpecialization;
 
-    shaderStages[1] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
-    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].module = fragmentShaderModule;
-    shaderStages[1].pName = "main";
-
-
+    if (hasFragmentShader) {
+        shaderStages[1] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = fragmentShaderModule;
+        shaderStages[1].pName = "main";
+        shaderStages[1].pSpecializationInfo = fragmentEntries.empty() ? nullptr : &fragmentSpecialization;
+    }
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescription();
+    // explicit vertex input is needed for instance rate or interleaving that differs from the shader's locations
+    std::vector<VkVertexInputBindingDescription> bindings = description.bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes = description.attributes;
+    if (bindings.empty()) {
+        reflectVertexInput(vertexReflection, bindings, attributes);
+    }
+    for (auto& input : vertexReflection.inputs) {
+        bool provided = std::any_of(attributes.begin(), attributes.end(), [&](const VkVertexInputAttributeDescription& attribute) {
+            return attribute.location == input.location;
+        });
+        if (!provided) {
+            throw std::runtime_error(description.vertexShader + " reads a vertex input location the description doesn't provide!");
+        }
+    }
 
     VkPipelineVertexInputStateCreateInfo vertexInputState = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
-    vertexInputState.vertexBindingDescriptionCount = 1;
-    vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputState.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputState.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertexInputState.pVertexBindingDescriptions = bindings.data();
+    vertexInputState.pVertexAttributeDescriptions = attributes.data();
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
-    inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssemblyState.topology = description.topology;
 
+    // viewport and scissor are dynamic, so one pipeline serves every framebuffer size
     VkPipelineViewportStateCreateInfo viewportState = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
     viewportState.viewportCount = 1;
-    VkViewport viewport = {0.0f, 0.0f, (float)width, (float)height};
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    VkRect2D scissor = {{0,0}, {width, height}};
-    viewportState.pScissors = &scissor;
 
     VkPipelineRasterizationStateCreateInfo rasterizationState = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    rasterizationState.polygonMode = description.polygonMode;
+    rasterizationState.cullMode = description.cullMode;
+    rasterizationState.frontFace = description.frontFace;
     rasterizationState.lineWidth = 1.0f;
 
     VkPipelineMultisampleStateCreateInfo multisampleState = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
-    multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampleState.rasterizationSamples = description.samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilState = { VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+    depthStencilState.depthTestEnable = description.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencilState.depthWriteEnable = description.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencilState.depthCompareOp = description.depthCompareOp;
+    depthStencilState.minDepthBounds = 0.0f;
+    depthStencilState.maxDepthBounds = 1.0f;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
+    // a depth only pipeline inside a pass with a color attachment must leave the color untouched
+    colorBlendAttachment.colorWriteMask = hasFragmentShader ? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT : 0;
+    colorBlendAttachment.blendEnable = description.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = description.srcColorBlendFactor;
+    colorBlendAttachment.dstColorBlendFactor = description.dstColorBlendFactor;
+    colorBlendAttachment.colorBlendOp = description.colorBlendOp;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
     VkPipelineColorBlendStateCreateInfo colorBlendState = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
-    colorBlendState.attachmentCount = 1;
+    colorBlendState.attachmentCount = description.renderPass != VK_NULL_HANDLE || description.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
     colorBlendState.pAttachments = &colorBlendAttachment;
 
-    VkPipelineLayout pipelineLayout;
+    std::vector<VkDescriptorSetLayout> setLayouts = description.setLayouts;
+    std::vector<VkPushConstantRange> pushConstants = description.pushConstants;
     {
-        VkPipelineLayoutCreateInfo createInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-        VAC(vkCreatePipelineLayout(context->device, &createInfo, 0, &pipelineLayout));
+        std::vector<const VulkanShaderReflection*> stages = { &vertexReflection };
+        if (hasFragmentShader) {
+            stages.push_back(&fragmentReflection);
+        }
+        std::vector<VkPushConstantRange> reflectedPushConstants;
+        // explicit set layouts are taken as they are, runtime sized arrays in them can't be reflected anyway
+        if (setLayouts.empty()) {
+            reflectPipelineLayout(context, stages, setLayouts, reflectedPushConstants);
+        } else if (pushConstants.empty()) {
+            reflectPushConstants(stages, reflectedPushConstants);
+        }
+        if (pushConstants.empty()) {
+            pushConstants = reflectedPushConstants;
+        }
     }
+    VkPipelineLayout pipelineLayout = getPipelineLayout(context, setLayouts, pushConstants);
 
     VkPipeline _pipeline;
     {
@@ -101,23 +276,80 @@ void createPipeline(VulkanContext* context, const char* vertexShaderFilename, co
         createInfo.pViewportState = &viewportState;
         createInfo.pRasterizationState = &rasterizationState;
         createInfo.pMultisampleState = &multisampleState;
+        createInfo.pDepthStencilState = &depthStencilState;
         createInfo.pColorBlendState = &colorBlendState;
         createInfo.pDynamicState = &dynamicStateCreateInfo;
         createInfo.layout = pipelineLayout;
-        createInfo.renderPass = renderPass;
-        createInfo.subpass = 0;
-        VAC(vkCreateGraphicsPipelines(context->device, 0, 1, &createInfo, 0, &_pipeline));
+        createInfo.renderPass = description.renderPass;
+        createInfo.subpass = description.subpass;
+
+        VkPipelineRenderingCreateInfo renderingCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
+        renderingCreateInfo.colorAttachmentCount = description.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+        renderingCreateInfo.pColorAttachmentFormats = &description.colorFormat;
+        renderingCreateInfo.depthAttachmentFormat = description.depthFormat;
+        if (description.renderPass == VK_NULL_HANDLE) {
+            createInfo.pNext = &renderingCreateInfo;
+        }
+        auto start = std::chrono::steady_clock::now();
+        VAC(vkCreateGraphicsPipelines(context->device, context->pipelineCache, 1, &createInfo, 0, &_pipeline));
+        auto end = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(pipelineStatsMutex);
+        context->pipelineCacheStats.pipelineCount++;
+        context->pipelineCacheStats.creationMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
     }
 
-    vkDestroyShaderModule(context->device, vertexShaderModule, 0);
-    vkDestroyShaderModule(context->device, fragmentShaderModule, 0);
+    pipeline = {};
+    pipeline.pipeline = _pipeline;
+    pipeline.pipelineLayout = pipelineLayout;
+    pipeline.setLayouts = setLayouts;
+}
+
+void createComputePipeline(VulkanContext* context, VkShaderModule shaderModule, const std::vector<VkDescriptorSetLayout>& setLayouts,
+    const std::vector<VkPushConstantRange>& pushConstants, VulkanPipeline& pipeline) {
+    VkPipelineLayout pipelineLayout = getPipelineLayout(context, setLayouts, pushConstants);
+
+    VkPipeline _pipeline;
+    {
+        VkComputePipelineCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+        createInfo.stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+        createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        createInfo.stage.module = shaderModule;
+        createInfo.stage.pName = "main";
+        createInfo.layout = pipelineLayout;
+        auto start = std::chrono::steady_clock::now();
+        VAC(vkCreateComputePipelines(context->device, context->pipelineCache, 1, &createInfo, 0, &_pipeline));
+        auto end = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(pipelineStatsMutex);
+        context->pipelineCacheStats.pipelineCount++;
+        context->pipelineCacheStats.creationMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    }
 
     pipeline = {};
     pipeline.pipeline = _pipeline;
     pipeline.pipelineLayout = pipelineLayout;
+    pipeline.setLayouts = setLayouts;
+}
+
+void createComputePipeline(VulkanContext* context, const char* shaderFilename, const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize, VulkanPipeline& pipeline) {
+    AcquiredShaderModules shaderModules { context };
+    VkShaderModule shaderModule = shaderModules.acquire(shaderFilename);
+    std::vector<VkPushConstantRange> pushConstants;
+    if (pushConstantSize > 0) {
+        pushConstants.push_back({ VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize });
+    }
+    createComputePipeline(context, shaderModule, setLayouts, pushConstants, pipeline);
+}
+
+void createComputePipeline(VulkanContext* context, const char* shaderFilename, VulkanPipeline& pipeline) {
+    VulkanShaderReflection reflection;
+    AcquiredShaderModules shaderModules { context };
+    VkShaderModule shaderModule = shaderModules.acquire(shaderFilename, &reflection);
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    std::vector<VkPushConstantRange> pushConstants;
+    reflectPipelineLayout(context, { &reflection }, setLayouts, pushConstants);
+    createComputePipeline(context, shaderModule, setLayouts, pushConstants, pipeline);
 }
 
 void destroyPipeline(VulkanContext* context, VulkanPipeline* pipeline) {
     vkDestroyPipeline(context->device, pipeline->pipeline, 0);
-    vkDestroyPipelineLayout(context->device, pipeline->pipelineLayout, 0);
 }
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+#include "vulkan-base.h"
+
+const uint32_t PROFILER_MAX_GPU_SCOPES = 64;
+const size_t PROFILER_HISTORY_SIZE = 256;
+const size_t PROFILER_MAX_TRACE_EVENTS = 1 << 18;
+
+struct GpuScope {
+    const char* name;
+    uint32_t query;
+    uint32_t depth;
+};
+
+struct ProfilerFrame {
+    VkQueryPool queryPool;
+    uint32_t queryCount;
+    std::vector<GpuScope> scopes;
+    uint32_t openScopes;
+    // cpu time of the submit, the gpu track of the trace is anchored to it
+    double submitTime;
+    bool pending;
+};
+
+struct CpuScope {
+    const char* name;
+    double start;
+};
+
+struct TraceEvent {
+    const char* name;
+    bool gpu;
+    uint32_t depth;
+    double start;
+    double duration;
+};
+
+// rolling window of the last durations per scope name
+struct ScopeHistory {
+    const char* name;
+    std::vector<double> samples;
+    size_t next;
+    bool gpu;
+};
+
+struct VulkanProfiler {
+    bool gpuSupported;
+    double timestampPeriod;
+    uint64_t timestampMask;
+    std::array<ProfilerFrame, MAX_FRAMES_IN_FLIGHT> frames;
+    std::vector<CpuScope> cpuScopes;
+    std::chrono::steady_clock::time_point origin;
+    bool tracing;
+    std::vector<TraceEvent> events;
+    std::unordered_map<std::string, ScopeHistory> history;
+};
+
+double profilerTime(const VulkanProfiler* profiler) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - profiler->origin).count();
+}
+
+void recordScope(VulkanProfiler* profiler, const char* name, bool gpu, uint32_t depth, double start, double duration) {
+    ScopeHistory& history = profiler->history[std::string(gpu ? "gpu:" : "cpu:") + name];
+    history.name = name;
+    history.gpu = gpu;
+    if (history.samples.size() < PROFILER_HISTORY_SIZE) {
+        history.samples.push_back(duration);
+    } else {
+        history.samples[history.next] = duration;
+        history.next = (history.next + 1) % PROFILER_HISTORY_SIZE;
+    }
+
+    if (profiler->tracing && profiler->events.size() < PROFILER_MAX_TRACE_EVENTS) {
+        profiler->events.push_back({ name, gpu, depth, start, duration });
+    }
+}
+
+void createProfiler(VulkanContext* context) {
+    VulkanProfiler* profiler = new VulkanProfiler {};
+    profiler->origin = std::chrono::steady_clock::now();
+
+    uint32_t familyCount {0};
+    vkGetPhysicalDeviceQueueFamilyProperties(context->physicalDevice, &familyCount, 0);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(context->physicalDevice, &familyCount, families.data());
+    uint32_t validBits = families[context->graphicsQueue.familyIndex].timestampValidBits;
+
+    profiler->gpuSupported = validBits > 0;
+    profiler->timestampPeriod = context->physicalDeviceProperties.limits.timestampPeriod;
+    profiler->timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    if (profiler->gpuSupported) {
+        for (auto& frame : profiler->frames) {
+            VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+            createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            createInfo.queryCount = 2 * PROFILER_MAX_GPU_SCOPES;
+            VAC(vkCreateQueryPool(context->device, &createInfo, 0, &frame.queryPool));
+        }
+    } else {
+        LOG(LOG_DEFAULT_UTILS, false, "graphics queue has no timestamps, only cpu scopes are profiled");
+    }
+    context->profiler = profiler;
+}
+
+void destroyProfiler(VulkanContext* context) {
+    VulkanProfiler* profiler = context->profiler;
+    for (auto& frame : profiler->frames) {
+        if (frame.queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(context->device, frame.queryPool, 0);
+        }
+    }
+    delete profiler;
+    context->profiler = nullptr;
+}
+
+void beginProfilerFrame(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer) {
+    VulkanProfiler* profiler = context->profiler;
+    ProfilerFrame& frame = profiler->frames[frameIndex];
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    frame.openScopes = 0;
+    frame.pending = false;
+    if (profiler->gpuSupported) {
+        vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, 2 * PROFILER_MAX_GPU_SCOPES);
+    }
+    beginGpuScope(context, frameIndex, commandBuffer, "frame");
+}
+
+void endProfilerFrame(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer) {
+    VulkanProfiler* profiler = context->profiler;
+    ProfilerFrame& frame = profiler->frames[frameIndex];
+    endGpuScope(context, frameIndex, commandBuffer, 0);
+    frame.submitTime = profilerTime(profiler);
+    frame.pending = profiler->gpuSupported && !frame.scopes.empty();
+}
+
+uint32_t beginGpuScope(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const char* name) {
+    VulkanProfiler* profiler = context->profiler;
+    ProfilerFrame& frame = profiler->frames[frameIndex];
+    // scopes past the limit are dropped, ending them is a no-op
+    if (!profiler->gpuSupported || frame.queryCount == 2 * PROFILER_MAX_GPU_SCOPES) {
+        return UINT32_MAX;
+    }
+    uint32_t scope = (uint32_t)frame.scopes.size();
+    frame.scopes.push_back({ name, frame.queryCount, frame.openScopes++ });
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, frame.queryCount);
+    frame.queryCount += 2;
+    return scope;
+}
+
+void endGpuScope(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, uint32_t scope) {
+    VulkanProfiler* profiler = context->profiler;
+    ProfilerFrame& frame = profiler->frames[frameIndex];
+    if (scope >= frame.scopes.size()) {
+        return;
+    }
+    frame.openScopes--;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.scopes[scope].query + 1);
+}
+
+// no wait flag, the caller already waited for the frame so the results are there, otherwise the frame is skipped
+double collectProfilerFrame(VulkanContext* context, uint32_t frameIndex) {
+    VulkanProfiler* profiler = context->profiler;
+    ProfilerFrame& frame = profiler->frames[frameIndex];
+    if (!frame.pending) {
+        return -1.0;
+    }
+    frame.pending = false;
+
+    std::vector<uint64_t> timestamps(frame.queryCount);
+    VkResult result = vkGetQueryPoolResults(context->device, frame.queryPool, 0, frame.queryCount, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result == VK_NOT_READY) {
+        return -1.0;
+    }
+    VAC(result);
+
+    // the frame scope opens first, so every other scope is placed relative to it
+    uint64_t frameStart = timestamps[0] & profiler->timestampMask;
+    double frameDuration {.0};
+    for (auto& scope : frame.scopes) {
+        uint64_t begin = timestamps[scope.query] & profiler->timestampMask;
+        uint64_t end = timestamps[scope.query + 1] & profiler->timestampMask;
+        double start = (double)((begin - frameStart) & profiler->timestampMask) * profiler->timestampPeriod / 1e3;
+        double duration = (double)((end - begin) & profiler->timestampMask) * profiler->timestampPeriod / 1e3;
+        recordScope(profiler, scope.name, true, scope.depth, frame.submitTime + start, duration);
+        if (scope.query == 0) {
+            frameDuration = duration;
+        }
+    }
+    return frameDuration / 1e3;
+}
+
+void beginCpuScope(VulkanContext* context, const char* name) {
+    VulkanProfiler* profiler = context->profiler;
+    profiler->cpuScopes.push_back({ name, profilerTime(profiler) });
+}
+
+void endCpuScope(VulkanContext* context) {
+    VulkanProfiler* profiler = context->profiler;
+    CpuScope scope = profiler->cpuScopes.back();
+    profiler->cpuScopes.pop_back();
+    recordScope(profiler, scope.name, false, (uint32_t)profiler->cpuScopes.size(), scope.start, profilerTime(profiler) - scope.start);
+}
+
+void startProfilerTrace(VulkanContext* context) {
+    VulkanProfiler* profiler = context->profiler;
+    profiler->events.clear();
+    profiler->tracing = true;
+}
+
+// chrome://tracing and perfetto both read this, cpu scopes on thread 1 and gpu scopes on thread 2
+bool writeProfilerTrace(VulkanContext* context, const std::string& filename) {
+    VulkanProfiler* profiler = context->profiler;
+    profiler->tracing = false;
+
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) {
+        LOG(LOG_ERROR_UTILS, false, "could not open trace output: %s", filename.c_str());
+        return false;
+    }
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}");
+    for (auto& event : profiler->events) {
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+            event.name, event.gpu ? "gpu" : "cpu", event.gpu ? 2 : 1, event.start, event.duration, event.depth);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    LOG(LOG_DEFAULT_UTILS, false, "wrote %zu trace events to %s", profiler->events.size(), filename.c_str());
+    profiler->events.clear();
+    return true;
+}
+
+// nearest rank, the smallest sample that at least p of all samples are less or equal to
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+std::vector<VulkanScopeStatistics> getProfilerStatistics(VulkanContext* context) {
+    VulkanProfiler* profiler = context->profiler;
+    std::vector<VulkanScopeStatistics> statistics;
+    for (auto& [key, history] : profiler->history) {
+        std::vector<double> sorted = history.samples;
+        std::sort(sorted.begin(), sorted.end());
+        statistics.push_back({ history.name, history.gpu, (uint32_t)sorted.size(), percentile(sorted, 0.5) / 1e3, percentile(sorted, 0.95) / 1e3,
+            percentile(sorted, 0.99) / 1e3 });
+    }
+    std::sort(statistics.begin(), statistics.end(), [](const VulkanScopeStatistics& a, const VulkanScopeStatistics& b) {
+        return a.gpu != b.gpu ? a.gpu < b.gpu : a.name < b.name;
+    });
+    return statistics;
+}
+
+void logProfilerSummary(VulkanContext* context) {
+    for (auto& scope : getProfilerStatistics(context)) {
+        LOG(LOG_DEFAULT_UTILS, false, "%s %s: median %.3fms p95 %.3fms p99 %.3fms", scope.gpu ? "gpu" : "cpu", scope.name.c_str(), scope.median, scope.p95, scope.p99);
+    }
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include "vulkan-base.h"
+#include "thread-pool.h"
+
+// below this many draws the secondary command buffer overhead outweighs the parallel recording
+const uint32_t PARALLEL_RECORDING_THRESHOLD = 512;
+const uint32_t MIN_DRAWS_PER_CHUNK = 256;
+
+struct RecordingPool {
+    VkCommandPool commandPool;
+    std::vector<VkCommandBuffer> commandBuffers;
+    uint32_t used;
+};
+
+// one pool per worker per frame in flight, command pools must never be used from two threads at once
+struct VulkanRecorder {
+    uint32_t workerCount;
+    std::vector<RecordingPool> pools;
+};
+
+RecordingPool& getRecordingPool(VulkanRecorder* recorder, uint32_t frameIndex, uint32_t workerIndex) {
+    return recorder->pools[frameIndex * recorder->workerCount + workerIndex];
+}
+
+void createRecorder(VulkanContext* context) {
+    VulkanRecorder* recorder = new VulkanRecorder {};
+    // the thread calling recordRenderPass records as the last worker
+    recorder->workerCount = context->threadPool->size() + 1;
+    recorder->pools.resize(MAX_FRAMES_IN_FLIGHT * recorder->workerCount);
+
+    for (auto& pool : recorder->pools) {
+        VkCommandPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+        createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        createInfo.queueFamilyIndex = context->graphicsQueue.familyIndex;
+        VAC(vkCreateCommandPool(context->device, &createInfo, 0, &pool.commandPool));
+    }
+
+    context->recorder = recorder;
+}
+
+void destroyRecorder(VulkanContext* context) {
+    VulkanRecorder* recorder = context->recorder;
+    for (auto& pool : recorder->pools) {
+        vkDestroyCommandPool(context->device, pool.commandPool, 0);
+    }
+    delete recorder;
+    context->recorder = nullptr;
+}
+
+// only valid once the last submission of that frame retired
+void resetRecorder(VulkanContext* context, uint32_t frameIndex) {
+    VulkanRecorder* recorder = context->recorder;
+    for (uint32_t i {0}; i < recorder->workerCount; i++) {
+        RecordingPool& pool = getRecordingPool(recorder, frameIndex, i);
+        if (pool.used > 0) {
+            VAC(vkResetCommandPool(context->device, pool.commandPool, 0));
+            pool.used = 0;
+        }
+    }
+}
+
+VkCommandBuffer acquireSecondaryCommandBuffer(VulkanContext* context, RecordingPool& pool) {
+    if (pool.used == pool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        allocateInfo.commandPool = pool.commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        VAC(vkAllocateCommandBuffers(context->device, &allocateInfo, &commandBuffer));
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+    return pool.commandBuffers[pool.used++];
+}
+
+// shared by both paths, begin is told whether the draws arrive as secondary command buffers
+void recordPass(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t drawCount,
+    const VulkanRecordCallback& record, const std::function<void(bool secondary)>& begin, const std::function<void()>& end) {
+    // timestamps are only written outside the pass, secondaries would each need their own queries
+    uint32_t scope = beginGpuScope(context, frameIndex, commandBuffer, "render pass");
+    if (drawCount < PARALLEL_RECORDING_THRESHOLD) {
+        begin(false);
+        if (drawCount > 0) {
+            record(commandBuffer, 0, drawCount);
+        }
+        end();
+        endGpuScope(context, frameIndex, commandBuffer, scope);
+        return;
+    }
+
+    VulkanRecorder* recorder = context->recorder;
+    // a few chunks per worker so uneven draw costs still balance out
+    uint32_t chunkCount = std::min(recorder->workerCount * 4, (drawCount + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK);
+    uint32_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers(chunkCount);
+
+    beginCpuScope(context, "parallel recording");
+    context->threadPool->parallelFor(chunkCount, [&](uint32_t chunk, uint32_t workerIndex) {
+        VkCommandBuffer secondary = acquireSecondaryCommandBuffer(context, getRecordingPool(recorder, frameIndex, workerIndex));
+
+        VkCommandBufferBeginInfo secondaryBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+        VAC(vkBeginCommandBuffer(secondary, &secondaryBeginInfo));
+
+        uint32_t firstDraw = std::min(chunk * chunkSize, drawCount);
+        record(secondary, firstDraw, std::min(chunkSize, drawCount - firstDraw));
+
+        VAC(vkEndCommandBuffer(secondary));
+        secondaryCommandBuffers[chunk] = secondary;
+    });
+    endCpuScope(context);
+
+    begin(true);
+    vkCmdExecuteCommands(commandBuffer, chunkCount, secondaryCommandBuffers.data());
+    end();
+    endGpuScope(context, frameIndex, commandBuffer, scope);
+}
+
+void recordRenderPass(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& beginInfo, uint32_t drawCount, const VulkanRecordCallback& record) {
+    VkCommandBufferInheritanceInfo inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    inheritanceInfo.renderPass = beginInfo.renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = beginInfo.framebuffer;
+
+    recordPass(context, frameIndex, commandBuffer, inheritanceInfo, drawCount, record, [&](bool secondary) {
+        vkCmdBeginRenderPass(commandBuffer, &beginInfo, secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    }, [&]() {
+        vkCmdEndRenderPass(commandBuffer);
+    });
+}
+
+void recordRendering(VulkanContext* context, uint32_t frameIndex, VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo, VkFormat colorFormat, VkFormat depthFormat,
+    VkSampleCountFlagBits samples, uint32_t drawCount, const VulkanRecordCallback& record) {
+    VkCommandBufferInheritanceRenderingInfo renderingInheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO };
+    renderingInheritanceInfo.colorAttachmentCount = colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+    renderingInheritanceInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInheritanceInfo.depthAttachmentFormat = depthFormat;
+    renderingInheritanceInfo.rasterizationSamples = samples;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    inheritanceInfo.pNext = &renderingInheritanceInfo;
+
+    recordPass(context, frameIndex, commandBuffer, inheritanceInfo, drawCount, record, [&](bool secondary) {
+        VkRenderingInfo info = renderingInfo;
+        info.flags = secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+        vkCmdBeginRendering(commandBuffer, &info);
+    }, [&]() {
+        vkCmdEndRendering(commandBuffer);
+    });
+}
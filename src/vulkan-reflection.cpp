@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <mutex>
+#include "vulkan-base.h"
+
+// the subset of the spir-v spec reflection needs
+enum SpirvOp {
+    SPIRV_OP_ENTRY_POINT = 15,
+    SPIRV_OP_TYPE_BOOL = 20,
+    SPIRV_OP_TYPE_INT = 21,
+    SPIRV_OP_TYPE_FLOAT = 22,
+    SPIRV_OP_TYPE_VECTOR = 23,
+    SPIRV_OP_TYPE_MATRIX = 24,
+    SPIRV_OP_TYPE_IMAGE = 25,
+    SPIRV_OP_TYPE_SAMPLER = 26,
+    SPIRV_OP_TYPE_SAMPLED_IMAGE = 27,
+    SPIRV_OP_TYPE_ARRAY = 28,
+    SPIRV_OP_TYPE_RUNTIME_ARRAY = 29,
+    SPIRV_OP_TYPE_STRUCT = 30,
+    SPIRV_OP_TYPE_POINTER = 32,
+    SPIRV_OP_CONSTANT = 43,
+    SPIRV_OP_SPEC_CONSTANT_TRUE = 48,
+    SPIRV_OP_SPEC_CONSTANT_FALSE = 49,
+    SPIRV_OP_SPEC_CONSTANT = 50,
+    SPIRV_OP_VARIABLE = 59,
+    SPIRV_OP_DECORATE = 71,
+    SPIRV_OP_MEMBER_DECORATE = 72
+};
+
+enum SpirvDecoration {
+    SPIRV_DECORATION_SPEC_ID = 1,
+    SPIRV_DECORATION_BLOCK = 2,
+    SPIRV_DECORATION_BUFFER_BLOCK = 3,
+    SPIRV_DECORATION_ARRAY_STRIDE = 6,
+    SPIRV_DECORATION_MATRIX_STRIDE = 7,
+    SPIRV_DECORATION_BUILT_IN = 11,
+    SPIRV_DECORATION_LOCATION = 30,
+    SPIRV_DECORATION_BINDING = 33,
+    SPIRV_DECORATION_DESCRIPTOR_SET = 34,
+    SPIRV_DECORATION_OFFSET = 35
+};
+
+enum SpirvStorageClass {
+    SPIRV_STORAGE_UNIFORM_CONSTANT = 0,
+    SPIRV_STORAGE_INPUT = 1,
+    SPIRV_STORAGE_UNIFORM = 2,
+    SPIRV_STORAGE_PUSH_CONSTANT = 9,
+    SPIRV_STORAGE_STORAGE_BUFFER = 12
+};
+
+const uint32_t SPIRV_NONE = UINT32_MAX;
+
+struct SpirvMember {
+    uint32_t offset {SPIRV_NONE};
+    uint32_t matrixStride {0};
+    bool builtIn {false};
+};
+
+// everything known about one result id after a single pass over the module
+struct SpirvId {
+    uint32_t opcode {0};
+    // the words after the result id
+    const uint32_t* operands {nullptr};
+    uint32_t operandCount {0};
+    // result type of constants and variables
+    uint32_t type {0};
+    uint32_t storageClass {0};
+    uint32_t set {SPIRV_NONE};
+    uint32_t binding {SPIRV_NONE};
+    uint32_t location {SPIRV_NONE};
+    uint32_t specId {SPIRV_NONE};
+    uint32_t arrayStride {0};
+    bool builtIn {false};
+    bool block {false};
+    bool bufferBlock {false};
+    std::vector<SpirvMember> members;
+};
+
+struct VulkanLayoutCache {
+    std::mutex mutex;
+    std::vector<std::pair<std::vector<VkDescriptorSetLayoutBinding>, VkDescriptorSetLayout>> setLayouts;
+    std::vector<std::pair<std::vector<VkDescriptorSetLayout>, std::vector<VkPushConstantRange>>> pipelineLayoutKeys;
+    std::vector<VkPipelineLayout> pipelineLayouts;
+};
+
+const SpirvId& getSpirvId(const std::vector<SpirvId>& ids, uint32_t id) {
+    if (id >= ids.size()) {
+        throw std::runtime_error("spir-v id out of bounds!");
+    }
+    return ids[id];
+}
+
+SpirvMember& getSpirvMember(SpirvId& id, uint32_t member) {
+    if (id.members.size() <= member) {
+        id.members.resize(member + 1);
+    }
+    return id.members[member];
+}
+
+uint32_t getSpirvArrayLength(const std::vector<SpirvId>& ids, const SpirvId& array) {
+    // spec constant lengths reflect their default
+    const SpirvId& length = getSpirvId(ids, array.operands[1]);
+    return length.operandCount > 0 ? length.operands[0] : 1;
+}
+
+uint32_t getSpirvTypeSize(const std::vector<SpirvId>& ids, uint32_t typeId, uint32_t matrixStride = 0) {
+    const SpirvId& type = getSpirvId(ids, typeId);
+    switch (type.opcode) {
+        case SPIRV_OP_TYPE_BOOL:
+            return 4;
+        case SPIRV_OP_TYPE_INT:
+        case SPIRV_OP_TYPE_FLOAT:
+            return type.operands[0] / 8;
+        case SPIRV_OP_TYPE_VECTOR:
+            return type.operands[1] * getSpirvTypeSize(ids, type.operands[0]);
+        case SPIRV_OP_TYPE_MATRIX:
+            return type.operands[1] * (matrixStride ? matrixStride : getSpirvTypeSize(ids, type.operands[0]));
+        case SPIRV_OP_TYPE_ARRAY:
+            return getSpirvArrayLength(ids, type) * (type.arrayStride ? type.arrayStride : getSpirvTypeSize(ids, type.operands[0]));
+        case SPIRV_OP_TYPE_STRUCT: {
+            uint32_t size {0};
+            for (uint32_t i {0}; i < type.operandCount; i++) {
+                SpirvMember member = i < type.members.size() ? type.members[i] : SpirvMember {};
+                uint32_t offset = member.offset != SPIRV_NONE ? member.offset : size;
+                size = std::max(size, offset + getSpirvTypeSize(ids, type.operands[i], member.matrixStride));
+            }
+            return size;
+        }
+    }
+    throw std::runtime_error("spir-v type without a size!");
+}
+
+// vertex inputs are scalars or vectors of 32 bit components
+VkFormat getSpirvInputFormat(const std::vector<SpirvId>& ids, uint32_t typeId) {
+    const SpirvId& type = getSpirvId(ids, typeId);
+    uint32_t componentCount = type.opcode == SPIRV_OP_TYPE_VECTOR ? type.operands[1] : 1;
+    const SpirvId& component = type.opcode == SPIRV_OP_TYPE_VECTOR ? getSpirvId(ids, type.operands[0]) : type;
+    if ((component.opcode != SPIRV_OP_TYPE_FLOAT && component.opcode != SPIRV_OP_TYPE_INT) || component.operands[0] != 32 || componentCount > 4) {
+        throw std::runtime_error("unsupported vertex input type!");
+    }
+    const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+    if (component.opcode == SPIRV_OP_TYPE_FLOAT) {
+        return floatFormats[componentCount - 1];
+    }
+    return component.operands[1] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+}
+
+VkDescriptorType getSpirvDescriptorType(const std::vector<SpirvId>& ids, const SpirvId& type, uint32_t storageClass) {
+    switch (type.opcode) {
+        case SPIRV_OP_TYPE_SAMPLER:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case SPIRV_OP_TYPE_IMAGE: {
+            // operands: sampled type, dim, depth, arrayed, ms, sampled (1 with a sampler, 2 as storage), format
+            const uint32_t dimBuffer = 5, dimSubpassData = 6;
+            uint32_t dim = type.operands[1];
+            bool storage = type.operands[5] == 2;
+            if (dim == dimSubpassData) {
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            }
+            if (dim == dimBuffer) {
+                return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        case SPIRV_OP_TYPE_STRUCT:
+            // spir-v before 1.3 marks storage buffers as uniform buffer blocks
+            if (storageClass == SPIRV_STORAGE_STORAGE_BUFFER || type.bufferBlock) {
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+    throw std::runtime_error("unsupported descriptor type!");
+}
+
+void reflectShader(const uint32_t* code, size_t wordCount, VulkanShaderReflection& reflection) {
+    reflection = {};
+    if (wordCount < 5) {
+        throw std::runtime_error("spir-v header is truncated!");
+    }
+    std::vector<SpirvId> ids(code[3]);
+    uint32_t executionModel {SPIRV_NONE};
+
+    const uint32_t* end = code + wordCount;
+    for (const uint32_t* word = code + 5; word < end;) {
+        uint32_t count = word[0] >> 16;
+        uint32_t opcode = word[0] & 0xffff;
+        if (count == 0 || word + count > end) {
+            throw std::runtime_error("spir-v instruction is truncated!");
+        }
+        switch (opcode) {
+            case SPIRV_OP_ENTRY_POINT:
+                // the first entry point decides the stage, modules with several aren't produced by glslc
+                if (executionModel == SPIRV_NONE) {
+                    executionModel = word[1];
+                }
+                break;
+            case SPIRV_OP_DECORATE: {
+                if (count < 3 || word[1] >= ids.size()) {
+                    break;
+                }
+                SpirvId& id = ids[word[1]];
+                uint32_t value = count > 3 ? word[3] : 0;
+                switch (word[2]) {
+                    case SPIRV_DECORATION_SPEC_ID: id.specId = value; break;
+                    case SPIRV_DECORATION_BLOCK: id.block = true; break;
+                    case SPIRV_DECORATION_BUFFER_BLOCK: id.bufferBlock = true; break;
+                    case SPIRV_DECORATION_ARRAY_STRIDE: id.arrayStride = value; break;
+                    case SPIRV_DECORATION_BUILT_IN: id.builtIn = true; break;
+                    case SPIRV_DECORATION_LOCATION: id.location = value; break;
+                    case SPIRV_DECORATION_BINDING: id.binding = value; break;
+                    case SPIRV_DECORATION_DESCRIPTOR_SET: id.set = value; break;
+                }
+                break;
+            }
+            case SPIRV_OP_MEMBER_DECORATE: {
+                if (count < 4 || word[1] >= ids.size()) {
+                    break;
+                }
+                SpirvMember& member = getSpirvMember(ids[word[1]], word[2]);
+                uint32_t value = count > 4 ? word[4] : 0;
+                switch (word[3]) {
+                    case SPIRV_DECORATION_OFFSET: member.offset = value; break;
+                    case SPIRV_DECORATION_MATRIX_STRIDE: member.matrixStride = value; break;
+                    case SPIRV_DECORATION_BUILT_IN: member.builtIn = true; break;
+                }
+                break;
+            }
+            case SPIRV_OP_TYPE_BOOL:
+            case SPIRV_OP_TYPE_INT:
+            case SPIRV_OP_TYPE_FLOAT:
+            case SPIRV_OP_TYPE_VECTOR:
+            case SPIRV_OP_TYPE_MATRIX:
+            case SPIRV_OP_TYPE_IMAGE:
+            case SPIRV_OP_TYPE_SAMPLER:
+            case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            case SPIRV_OP_TYPE_ARRAY:
+            case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+            case SPIRV_OP_TYPE_STRUCT:
+            case SPIRV_OP_TYPE_POINTER: {
+                if (count < 2 || word[1] >= ids.size()) {
+                    throw std::runtime_error("spir-v type id out of bounds!");
+                }
+                SpirvId& id = ids[word[1]];
+                id.opcode = opcode;
+                id.operands = word + 2;
+                id.operandCount = count - 2;
+                break;
+            }
+            case SPIRV_OP_CONSTANT:
+            case SPIRV_OP_SPEC_CONSTANT_TRUE:
+            case SPIRV_OP_SPEC_CONSTANT_FALSE:
+            case SPIRV_OP_SPEC_CONSTANT:
+            case SPIRV_OP_VARIABLE: {
+                if (count < 3 || word[2] >= ids.size()) {
+                    throw std::runtime_error("spir-v result id out of bounds!");
+                }
+                SpirvId& id = ids[word[2]];
+                id.opcode = opcode;
+                id.type = word[1];
+                id.operands = word + 3;
+                id.operandCount = count - 3;
+                id.storageClass = opcode == SPIRV_OP_VARIABLE ? word[3] : 0;
+                break;
+            }
+        }
+        word += count;
+    }
+
+    switch (executionModel) {
+        case 0: reflection.stage = VK_SHADER_STAGE_VERTEX_BIT; break;
+        case 1: reflection.stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT; break;
+        case 2: reflection.stage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT; break;
+        case 3: reflection.stage = VK_SHADER_STAGE_GEOMETRY_BIT; break;
+        case 4: reflection.stage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+        case 5: reflection.stage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+        default: throw std::runtime_error("spir-v module has no supported entry point!");
+    }
+
+    for (uint32_t i {0}; i < ids.size(); i++) {
+        const SpirvId& id = ids[i];
+        if (id.specId != SPIRV_NONE && (id.opcode == SPIRV_OP_SPEC_CONSTANT || id.opcode == SPIRV_OP_SPEC_CONSTANT_TRUE || id.opcode == SPIRV_OP_SPEC_CONSTANT_FALSE)) {
+            reflection.specializationConstants.push_back({ id.specId, getSpirvTypeSize(ids, id.type) });
+        }
+        if (id.opcode != SPIRV_OP_VARIABLE || id.builtIn) {
+            continue;
+        }
+        const SpirvId& pointer = getSpirvId(ids, id.type);
+        if (pointer.opcode != SPIRV_OP_TYPE_POINTER) {
+            throw std::runtime_error("spir-v variable is not a pointer!");
+        }
+        uint32_t typeId = pointer.operands[1];
+        const SpirvId& type = getSpirvId(ids, typeId);
+
+        if (id.storageClass == SPIRV_STORAGE_INPUT && reflection.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+            if (id.location == SPIRV_NONE) {
+                continue;
+            }
+            // matrices and arrays take one location per column or element
+            uint32_t locationCount {1};
+            uint32_t elementType = typeId;
+            if (type.opcode == SPIRV_OP_TYPE_ARRAY) {
+                locationCount = getSpirvArrayLength(ids, type);
+                elementType = type.operands[0];
+            }
+            const SpirvId& element = getSpirvId(ids, elementType);
+            if (element.opcode == SPIRV_OP_TYPE_MATRIX) {
+                locationCount *= element.operands[1];
+                elementType = element.operands[0];
+            }
+            VkFormat format = getSpirvInputFormat(ids, elementType);
+            uint32_t size = getSpirvTypeSize(ids, elementType);
+            for (uint32_t location {0}; location < locationCount; location++) {
+                reflection.inputs.push_back({ id.location + location, format, size });
+            }
+        } else if (id.storageClass == SPIRV_STORAGE_PUSH_CONSTANT) {
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, getSpirvTypeSize(ids, typeId));
+        } else if (id.storageClass == SPIRV_STORAGE_UNIFORM_CONSTANT || id.storageClass == SPIRV_STORAGE_UNIFORM || id.storageClass == SPIRV_STORAGE_STORAGE_BUFFER) {
+            if (id.set == SPIRV_NONE || id.binding == SPIRV_NONE) {
+                continue;
+            }
+            uint32_t descriptorCount {1};
+            const SpirvId* resource = &type;
+            if (type.opcode == SPIRV_OP_TYPE_ARRAY) {
+                descriptorCount = getSpirvArrayLength(ids, type);
+                resource = &getSpirvId(ids, type.operands[0]);
+            } else if (type.opcode == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+                descriptorCount = 0;
+                resource = &getSpirvId(ids, type.operands[0]);
+            }
+            reflection.bindings.push_back({ id.set, id.binding, getSpirvDescriptorType(ids, *resource, id.storageClass), descriptorCount });
+        }
+    }
+    std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const VulkanReflectedInput& a, const VulkanReflectedInput& b) {
+        return a.location < b.location;
+    });
+}
+
+void reflectVertexInput(const VulkanShaderReflection& reflection, std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes) {
+    bindings.clear();
+    attributes.clear();
+    uint32_t offset {0};
+    for (auto& input : reflection.inputs) {
+        attributes.push_back({ input.location, 0, input.format, offset });
+        offset += input.size;
+    }
+    if (!attributes.empty()) {
+        bindings.push_back({ 0, offset, VK_VERTEX_INPUT_RATE_VERTEX });
+    }
+}
+
+void createLayoutCache(VulkanContext* context) {
+    context->layoutCache = new VulkanLayoutCache {};
+}
+
+void destroyLayoutCache(VulkanContext* context) {
+    VulkanLayoutCache* cache = context->layoutCache;
+    for (auto pipelineLayout : cache->pipelineLayouts) {
+        vkDestroyPipelineLayout(context->device, pipelineLayout, 0);
+    }
+    for (auto& [bindings, setLayout] : cache->setLayouts) {
+        vkDestroyDescriptorSetLayout(context->device, setLayout, 0);
+    }
+    delete cache;
+    context->layoutCache = nullptr;
+}
+
+VkDescriptorSetLayout getDescriptorSetLayout(VulkanContext* context, std::vector<VkDescriptorSetLayoutBinding> bindings) {
+    VulkanLayoutCache* cache = context->layoutCache;
+    std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding < b.binding;
+    });
+    auto sameBinding = [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+            && a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+    };
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    for (auto& [cachedBindings, setLayout] : cache->setLayouts) {
+        if (std::equal(bindings.begin(), bindings.end(), cachedBindings.begin(), cachedBindings.end(), sameBinding)) {
+            return setLayout;
+        }
+    }
+
+    VkDescriptorSetLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    createInfo.bindingCount = (uint32_t)bindings.size();
+    createInfo.pBindings = bindings.data();
+    VkDescriptorSetLayout setLayout;
+    VAC(vkCreateDescriptorSetLayout(context->device, &createInfo, 0, &setLayout));
+    cache->setLayouts.push_back({ bindings, setLayout });
+    return setLayout;
+}
+
+VkPipelineLayout getPipelineLayout(VulkanContext* context, const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants) {
+    VulkanLayoutCache* cache = context->layoutCache;
+    auto sameRange = [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+        return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+    };
+
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    for (size_t i {0}; i < cache->pipelineLayoutKeys.size(); i++) {
+        auto& [cachedSetLayouts, cachedPushConstants] = cache->pipelineLayoutKeys[i];
+        if (cachedSetLayouts == setLayouts
+            && std::equal(pushConstants.begin(), pushConstants.end(), cachedPushConstants.begin(), cachedPushConstants.end(), sameRange)) {
+            return cache->pipelineLayouts[i];
+        }
+    }
+
+    VkPipelineLayoutCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    createInfo.setLayoutCount = (uint32_t)setLayouts.size();
+    createInfo.pSetLayouts = setLayouts.data();
+    createInfo.pushConstantRangeCount = (uint32_t)pushConstants.size();
+    createInfo.pPushConstantRanges = pushConstants.data();
+    VkPipelineLayout pipelineLayout;
+    VAC(vkCreatePipelineLayout(context->device, &createInfo, 0, &pipelineLayout));
+    cache->pipelineLayoutKeys.push_back({ setLayouts, pushConstants });
+    cache->pipelineLayouts.push_back(pipelineLayout);
+    return pipelineLayout;
+}
+
+void reflectPushConstants(const std::vector<const VulkanShaderReflection*>& stages, std::vector<VkPushConstantRange>& pushConstants) {
+    VkPushConstantRange pushConstantRange = {};
+    for (auto* stage : stages) {
+        if (stage->pushConstantSize > 0) {
+            pushConstantRange.stageFlags |= stage->stage;
+            pushConstantRange.size = std::max(pushConstantRange.size, stage->pushConstantSize);
+        }
+    }
+    pushConstants.clear();
+    if (pushConstantRange.size > 0) {
+        pushConstants.push_back(pushConstantRange);
+    }
+}
+
+void reflectPipelineLayout(VulkanContext* context, const std::vector<const VulkanShaderReflection*>& stages,
+    std::vector<VkDescriptorSetLayout>& setLayouts, std::vector<VkPushConstantRange>& pushConstants) {
+    // bindings used by several stages are merged into one with the union of their stage flags
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+    for (auto* stage : stages) {
+        for (auto& reflected : stage->bindings) {
+            if (reflected.count == 0) {
+                throw std::runtime_error("runtime descriptor arrays need an explicit set layout!");
+            }
+            if (sets.size() <= reflected.set) {
+                sets.resize(reflected.set + 1);
+            }
+            auto& bindings = sets[reflected.set];
+            auto binding = std::find_if(bindings.begin(), bindings.end(), [&](const VkDescriptorSetLayoutBinding& b) {
+                return b.binding == reflected.binding;
+            });
+            if (binding == bindings.end()) {
+                bindings.push_back({ reflected.binding, reflected.type, reflected.count, (VkShaderStageFlags)stage->stage, nullptr });
+            } else if (binding->descriptorType != reflected.type) {
+                throw std::runtime_error("stages disagree on a descriptor type!");
+            } else {
+                binding->descriptorCount = std::max(binding->descriptorCount, reflected.count);
+                binding->stageFlags |= stage->stage;
+            }
+        }
+    }
+
+    setLayouts.clear();
+    for (auto& bindings : sets) {
+        setLayouts.push_back(getDescriptorSetLayout(context, bindings));
+    }
+    reflectPushConstants(stages, pushConstants);
+}
@@ -0,0 +1,524 @@
+#include <algorithm>
+#include "vulkan-base.h"
+
+struct GraphResource {
+    const char* name;
+    bool imported;
+    VkImage image;
+    VkImageView imageView;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    VkSampleCountFlagBits samples;
+    VkClearValue clearValue;
+    VkImageLayout initialLayout;
+    VkPipelineStageFlags2 initialStages;
+    VkImageLayout finalLayout;
+
+    // filled in while compiling
+    bool needed;
+    VkImageUsageFlags usage;
+    uint32_t firstPass;
+    uint32_t lastPass;
+    uint32_t slot;
+    bool written;
+
+    // state the next barrier starts from
+    VkImageLayout layout;
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+};
+
+// one memory range shared by transient images whose lifetimes don't overlap
+struct GraphMemorySlot {
+    VkMemoryRequirements requirements;
+    bool lazy;
+    std::vector<uint32_t> residents;
+    // every stage and access that touches the slot in a frame, the first use waits on them from the previous frame
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+};
+
+// what the transient images were realized for, unchanged descriptions reuse the images and memory
+struct GraphTransientKey {
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags usage;
+    uint32_t firstPass;
+    uint32_t lastPass;
+
+    bool operator==(const GraphTransientKey& other) const {
+        return width == other.width && height == other.height && format == other.format && samples == other.samples && usage == other.usage
+            && firstPass == other.firstPass && lastPass == other.lastPass;
+    }
+};
+
+struct VulkanRenderGraph {
+    std::vector<GraphResource> resources;
+    std::vector<VulkanGraphPass> passes;
+    std::vector<bool> livePasses;
+
+    std::vector<GraphTransientKey> realizedKeys;
+    std::vector<VkImage> images;
+    std::vector<VkImageView> imageViews;
+    std::vector<GraphMemorySlot> slots;
+    std::vector<VulkanAllocation> slotMemory;
+};
+
+struct GraphAccessInfo {
+    VkImageLayout layout;
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageUsageFlags usage;
+    bool write;
+};
+
+GraphAccessInfo getAccessInfo(VulkanGraphAccess access, bool graphics) {
+    VkPipelineStageFlags2 shaderStages = graphics ? VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    VkPipelineStageFlags2 depthStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    switch (access) {
+        case GRAPH_ACCESS_COLOR_ATTACHMENT:
+            return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true };
+        case GRAPH_ACCESS_COLOR_RESOLVE:
+            return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true };
+        case GRAPH_ACCESS_DEPTH_ATTACHMENT:
+            return { VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, depthStages,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true };
+        case GRAPH_ACCESS_DEPTH_READ:
+            return { VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, depthStages, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false };
+        case GRAPH_ACCESS_SAMPLED:
+            return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shaderStages, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+        case GRAPH_ACCESS_STORAGE_READ:
+            return { VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_USAGE_STORAGE_BIT, false };
+        case GRAPH_ACCESS_STORAGE_WRITE:
+            return { VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT, true };
+        case GRAPH_ACCESS_TRANSFER_SRC:
+            return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false };
+        case GRAPH_ACCESS_TRANSFER_DST:
+            return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true };
+    }
+    throw std::runtime_error("unknown render graph access!");
+}
+
+bool isAttachmentAccess(VulkanGraphAccess access) {
+    return access == GRAPH_ACCESS_COLOR_ATTACHMENT || access == GRAPH_ACCESS_COLOR_RESOLVE || access == GRAPH_ACCESS_DEPTH_ATTACHMENT || access == GRAPH_ACCESS_DEPTH_READ;
+}
+
+void createRenderGraph(VulkanContext* context, VulkanRenderGraph*& graph) {
+    graph = new VulkanRenderGraph {};
+}
+
+void releaseTransients(VulkanContext* context, VulkanRenderGraph* graph) {
+    // frames still in flight may be rendering into the old images
+    std::vector<VkImage> images;
+    std::vector<VkImageView> imageViews;
+    std::vector<VulkanAllocation> slotMemory;
+    images.swap(graph->images);
+    imageViews.swap(graph->imageViews);
+    slotMemory.swap(graph->slotMemory);
+    graph->realizedKeys.clear();
+    if (images.empty() && slotMemory.empty()) {
+        return;
+    }
+    deferDeletion(context, [context, images, imageViews, slotMemory]() mutable {
+        for (size_t i {0}; i < images.size(); i++) {
+            vkDestroyImageView(context->device, imageViews[i], 0);
+            vkDestroyImage(context->device, images[i], 0);
+        }
+        for (auto& allocation : slotMemory) {
+            freeMemory(context, allocation);
+        }
+    });
+}
+
+void destroyRenderGraph(VulkanContext* context, VulkanRenderGraph*& graph) {
+    releaseTransients(context, graph);
+    delete graph;
+    graph = nullptr;
+}
+
+void resetRenderGraph(VulkanRenderGraph* graph) {
+    graph->resources.clear();
+    graph->passes.clear();
+}
+
+VulkanGraphResource importGraphImage(VulkanRenderGraph* graph, const char* name, VkImage image, VkImageView imageView, VkFormat format, uint32_t width, uint32_t height,
+    VkImageLayout initialLayout, VkPipelineStageFlags2 initialStages, VkImageLayout finalLayout, VkClearValue clearValue) {
+    GraphResource resource = {};
+    resource.name = name;
+    resource.imported = true;
+    resource.image = image;
+    resource.imageView = imageView;
+    resource.format = format;
+    resource.width = width;
+    resource.height = height;
+    resource.samples = VK_SAMPLE_COUNT_1_BIT;
+    resource.clearValue = clearValue;
+    resource.initialLayout = initialLayout;
+    resource.initialStages = initialStages;
+    resource.finalLayout = finalLayout;
+    graph->resources.push_back(resource);
+    return (VulkanGraphResource)graph->resources.size() - 1;
+}
+
+VulkanGraphResource createGraphImage(VulkanRenderGraph* graph, const char* name, uint32_t width, uint32_t height, VkFormat format, VkClearValue clearValue,
+    VkSampleCountFlagBits samples) {
+    GraphResource resource = {};
+    resource.name = name;
+    resource.format = format;
+    resource.width = width;
+    resource.height = height;
+    resource.samples = samples;
+    resource.clearValue = clearValue;
+    resource.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    graph->resources.push_back(resource);
+    return (VulkanGraphResource)graph->resources.size() - 1;
+}
+
+void addGraphPass(VulkanRenderGraph* graph, VulkanGraphPass pass) {
+    graph->passes.push_back(std::move(pass));
+}
+
+VkImageView getGraphImageView(const VulkanRenderGraph* graph, VulkanGraphResource resource) {
+    return graph->resources[resource].imageView;
+}
+
+// walks the passes backwards from the imported images, anything that doesn't contribute to them is dropped
+void cullPasses(VulkanRenderGraph* graph) {
+    std::vector<bool> needed(graph->resources.size(), false);
+    for (size_t i {0}; i < graph->resources.size(); i++) {
+        needed[i] = graph->resources[i].imported;
+    }
+
+    graph->livePasses.assign(graph->passes.size(), false);
+    for (size_t i = graph->passes.size(); i-- > 0;) {
+        const VulkanGraphPass& pass = graph->passes[i];
+        bool live = pass.sideEffects;
+        for (auto& use : pass.uses) {
+            live = live || (getAccessInfo(use.access, true).write && needed[use.resource]);
+        }
+        if (!live) {
+            continue;
+        }
+        graph->livePasses[i] = true;
+        // attachments written with a load read the previous contents as well
+        for (auto& use : pass.uses) {
+            needed[use.resource] = true;
+        }
+    }
+}
+
+// creates the transient images and packs them greedily into memory slots by lifetime
+void realizeTransients(VulkanContext* context, VulkanRenderGraph* graph, const std::vector<uint32_t>& transients, const std::vector<GraphTransientKey>& keys) {
+    releaseTransients(context, graph);
+    graph->slots.clear();
+
+    VkDeviceSize unaliasedSize {0};
+    for (size_t i {0}; i < transients.size(); i++) {
+        GraphResource& resource = graph->resources[transients[i]];
+
+        // images only ever used as attachments inside passes can live in lazily allocated memory on tilers
+        const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        bool lazy = (resource.usage & ~attachmentUsage) == 0;
+
+        VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.format;
+        imageInfo.extent = { resource.width, resource.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = resource.samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = resource.usage | (lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImage image;
+        VAC(vkCreateImage(context->device, &imageInfo, 0, &image));
+        graph->images.push_back(image);
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(context->device, image, &requirements);
+        unaliasedSize += requirements.size;
+        lazy = lazy && hasMemoryType(context, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+        uint32_t slotIndex {0};
+        for (; slotIndex < graph->slots.size(); slotIndex++) {
+            GraphMemorySlot& slot = graph->slots[slotIndex];
+            if (slot.lazy != lazy || (slot.requirements.memoryTypeBits & requirements.memoryTypeBits) == 0) {
+                continue;
+            }
+            bool overlaps = false;
+            for (uint32_t resident : slot.residents) {
+                const GraphResource& other = graph->resources[transients[resident]];
+                overlaps = overlaps || (resource.firstPass <= other.lastPass && other.firstPass <= resource.lastPass);
+            }
+            if (!overlaps) {
+                break;
+            }
+        }
+        if (slotIndex == graph->slots.size()) {
+            GraphMemorySlot slot = {};
+            slot.requirements = requirements;
+            slot.lazy = lazy;
+            graph->slots.push_back(slot);
+        }
+        GraphMemorySlot& slot = graph->slots[slotIndex];
+        slot.requirements.size = std::max(slot.requirements.size, requirements.size);
+        slot.requirements.alignment = std::max(slot.requirements.alignment, requirements.alignment);
+        slot.requirements.memoryTypeBits &= requirements.memoryTypeBits;
+        slot.residents.push_back((uint32_t)i);
+    }
+
+    VkDeviceSize aliasedSize {0};
+    graph->slotMemory.resize(graph->slots.size());
+    for (size_t i {0}; i < graph->slots.size(); i++) {
+        GraphMemorySlot& slot = graph->slots[i];
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (slot.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+        allocateMemory(context, slot.requirements, properties, graph->slotMemory[i]);
+        aliasedSize += slot.requirements.size;
+        for (uint32_t resident : slot.residents) {
+            VAC(vkBindImageMemory(context->device, graph->images[resident], graph->slotMemory[i].memory, graph->slotMemory[i].offset));
+        }
+    }
+
+    for (size_t i {0}; i < transients.size(); i++) {
+        const GraphResource& resource = graph->resources[transients[i]];
+        VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        viewInfo.image = graph->images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.format;
+        viewInfo.subresourceRange = { (VkImageAspectFlags)(isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+        VkImageView imageView;
+        VAC(vkCreateImageView(context->device, &viewInfo, 0, &imageView));
+        graph->imageViews.push_back(imageView);
+    }
+
+    graph->realizedKeys = keys;
+    LOG(LOG_DEFAULT_UTILS, false, "render graph: %zu transient images in %zu memory slots, %llu instead of %llu bytes",
+        transients.size(), graph->slots.size(), (unsigned long long)aliasedSize, (unsigned long long)unaliasedSize);
+}
+
+void compileRenderGraph(VulkanContext* context, VulkanRenderGraph* graph) {
+    cullPasses(graph);
+
+    for (auto& resource : graph->resources) {
+        resource.needed = false;
+        resource.usage = 0;
+        resource.written = false;
+    }
+    for (uint32_t i {0}; i < graph->passes.size(); i++) {
+        if (!graph->livePasses[i]) {
+            continue;
+        }
+        bool graphics = (bool)graph->passes[i].record;
+        for (auto& use : graph->passes[i].uses) {
+            GraphResource& resource = graph->resources[use.resource];
+            if (!resource.needed) {
+                resource.firstPass = i;
+            }
+            resource.needed = true;
+            resource.lastPass = i;
+            resource.usage |= getAccessInfo(use.access, graphics).usage;
+        }
+    }
+
+    std::vector<uint32_t> transients;
+    std::vector<GraphTransientKey> keys;
+    for (uint32_t i {0}; i < graph->resources.size(); i++) {
+        const GraphResource& resource = graph->resources[i];
+        if (!resource.imported && resource.needed) {
+            transients.push_back(i);
+            keys.push_back({ resource.width, resource.height, resource.format, resource.samples, resource.usage, resource.firstPass, resource.lastPass });
+        }
+    }
+    if (keys != graph->realizedKeys) {
+        realizeTransients(context, graph, transients, keys);
+    }
+
+    for (auto& slot : graph->slots) {
+        slot.stages = 0;
+        slot.access = 0;
+    }
+    for (size_t i {0}; i < transients.size(); i++) {
+        GraphResource& resource = graph->resources[transients[i]];
+        resource.image = graph->images[i];
+        resource.imageView = graph->imageViews[i];
+        for (uint32_t slotIndex {0}; slotIndex < graph->slots.size(); slotIndex++) {
+            auto& residents = graph->slots[slotIndex].residents;
+            if (std::find(residents.begin(), residents.end(), (uint32_t)i) != residents.end()) {
+                resource.slot = slotIndex;
+            }
+        }
+    }
+
+    for (uint32_t i {0}; i < graph->passes.size(); i++) {
+        if (!graph->livePasses[i]) {
+            continue;
+        }
+        bool graphics = (bool)graph->passes[i].record;
+        for (auto& use : graph->passes[i].uses) {
+            GraphResource& resource = graph->resources[use.resource];
+            if (!resource.imported) {
+                GraphAccessInfo info = getAccessInfo(use.access, graphics);
+                graph->slots[resource.slot].stages |= info.stages;
+                graph->slots[resource.slot].access |= info.access;
+            }
+        }
+    }
+
+    for (auto& resource : graph->resources) {
+        resource.layout = resource.initialLayout;
+        if (resource.imported) {
+            resource.stages = resource.initialStages;
+            resource.access = 0;
+        } else {
+            // the previous frame (or the image aliased before it) may still be using the memory
+            resource.stages = graph->slots.empty() || !resource.needed ? 0 : graph->slots[resource.slot].stages;
+            resource.access = graph->slots.empty() || !resource.needed ? 0 : graph->slots[resource.slot].access;
+        }
+    }
+}
+
+VkImageAspectFlags getAspectMask(VkFormat format) {
+    return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+// moves the resource into the state the use needs, read after read in the same layout needs no barrier
+void addUseBarrier(GraphResource& resource, const GraphAccessInfo& info, std::vector<VkImageMemoryBarrier2>& barriers) {
+    const VkAccessFlags2 writeAccess = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+        | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+    bool previousWrite = (resource.access & writeAccess) != 0;
+    if (resource.layout == info.layout && !previousWrite && !info.write && resource.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+        resource.stages |= info.stages;
+        resource.access |= info.access;
+        return;
+    }
+
+    VkImageMemoryBarrier2 barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = resource.stages;
+    barrier.srcAccessMask = resource.access & writeAccess;
+    barrier.dstStageMask = info.stages;
+    barrier.dstAccessMask = info.access;
+    barrier.oldLayout = resource.layout;
+    barrier.newLayout = info.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = resource.image;
+    barrier.subresourceRange = { getAspectMask(resource.format), 0, 1, 0, 1 };
+    barriers.push_back(barrier);
+
+    resource.layout = info.layout;
+    resource.stages = info.stages;
+    resource.access = info.access;
+}
+
+void flushBarriers(VkCommandBuffer commandBuffer, std::vector<VkImageMemoryBarrier2>& barriers) {
+    if (barriers.empty()) {
+        return;
+    }
+    VkDependencyInfo dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dependencyInfo.imageMemoryBarrierCount = (uint32_t)barriers.size();
+    dependencyInfo.pImageMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    barriers.clear();
+}
+
+void executeGraphicsPass(VulkanContext* context, VulkanRenderGraph* graph, VulkanFrame& frame, uint32_t passIndex) {
+    const VulkanGraphPass& pass = graph->passes[passIndex];
+
+    VkRenderingAttachmentInfo colorAttachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+    VkRenderingAttachmentInfo depthAttachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
+    VkFormat colorFormat {VK_FORMAT_UNDEFINED};
+    VkFormat depthFormat {VK_FORMAT_UNDEFINED};
+    VkSampleCountFlagBits samples {VK_SAMPLE_COUNT_1_BIT};
+    VkExtent2D extent = { 0, 0 };
+    for (auto& use : pass.uses) {
+        if (!isAttachmentAccess(use.access)) {
+            continue;
+        }
+        GraphResource& resource = graph->resources[use.resource];
+        extent = { resource.width, resource.height };
+        if (use.access == GRAPH_ACCESS_COLOR_RESOLVE) {
+            if (colorAttachment.resolveImageView != VK_NULL_HANDLE) {
+                throw std::runtime_error("render graph passes support one resolve attachment!");
+            }
+            // resolved at the end of the pass, whatever the target held before is overwritten
+            colorAttachment.resolveImageView = resource.imageView;
+            colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+            continue;
+        }
+        bool depth = use.access != GRAPH_ACCESS_COLOR_ATTACHMENT;
+        VkRenderingAttachmentInfo& attachment = depth ? depthAttachment : colorAttachment;
+        if (attachment.imageView != VK_NULL_HANDLE) {
+            throw std::runtime_error("render graph passes support one color and one depth attachment!");
+        }
+        attachment.imageView = resource.imageView;
+        attachment.imageLayout = getAccessInfo(use.access, true).layout;
+        // the first writer clears, unless an imported image comes with contents
+        bool firstWrite = use.access != GRAPH_ACCESS_DEPTH_READ && !resource.written && resource.initialLayout == VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.loadOp = firstWrite ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+        // transient contents nobody reads later never have to leave the tile
+        bool readLater = resource.imported || resource.lastPass > passIndex;
+        attachment.storeOp = readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.clearValue = resource.clearValue;
+        (depth ? depthFormat : colorFormat) = resource.format;
+        samples = resource.samples;
+    }
+    if (colorAttachment.resolveImageView != VK_NULL_HANDLE && (colorFormat == VK_FORMAT_UNDEFINED || samples == VK_SAMPLE_COUNT_1_BIT)) {
+        throw std::runtime_error("render graph resolves need a multisampled color attachment in the same pass!");
+    }
+
+    VkRenderingInfo renderingInfo = { VK_STRUCTURE_TYPE_RENDERING_INFO };
+    renderingInfo.renderArea = { {0, 0}, extent };
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = depthFormat != VK_FORMAT_UNDEFINED ? &depthAttachment : nullptr;
+    recordRendering(context, frame.index, frame.commandBuffer, renderingInfo, colorFormat, depthFormat, samples, pass.drawCount, pass.record);
+}
+
+void executeRenderGraph(VulkanContext* context, VulkanRenderGraph* graph, VulkanFrame& frame) {
+    compileRenderGraph(context, graph);
+
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+    std::vector<VkImageMemoryBarrier2> barriers;
+    for (uint32_t i {0}; i < graph->passes.size(); i++) {
+        if (!graph->livePasses[i]) {
+            continue;
+        }
+        const VulkanGraphPass& pass = graph->passes[i];
+        bool graphics = (bool)pass.record;
+        for (auto& use : pass.uses) {
+            addUseBarrier(graph->resources[use.resource], getAccessInfo(use.access, graphics), barriers);
+        }
+
+        uint32_t scope = beginGpuScope(context, frame.index, commandBuffer, pass.name);
+        flushBarriers(commandBuffer, barriers);
+        if (graphics) {
+            executeGraphicsPass(context, graph, frame, i);
+        } else if (pass.execute) {
+            pass.execute(commandBuffer);
+        }
+        endGpuScope(context, frame.index, commandBuffer, scope);
+
+        for (auto& use : pass.uses) {
+            GraphResource& resource = graph->resources[use.resource];
+            resource.written = resource.written || getAccessInfo(use.access, graphics).write;
+        }
+    }
+
+    // imported images leave in the layout their owner expects, batched into one barrier
+    for (auto& resource : graph->resources) {
+        if (!resource.imported || !resource.needed || resource.layout == resource.finalLayout) {
+            continue;
+        }
+        GraphAccessInfo info = { resource.finalLayout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, 0, false };
+        addUseBarrier(resource, info, barriers);
+    }
+    flushBarriers(commandBuffer, barriers);
+}
@@ -0,0 +1,302 @@
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_SSE2
+#include <emmintrin.h>
+#endif
+#include "vulkan-base.h"
+
+const uint8_t ALL_FRAMES_PENDING = (uint8_t)((1u << MAX_FRAMES_IN_FLIGHT) - 1);
+static_assert(MAX_FRAMES_IN_FLIGHT <= 8, "pending frames are tracked in a byte per entity");
+
+void createScene(VulkanContext* context, uint32_t capacity, VulkanScene& scene) {
+    scene = {};
+    scene.capacity = capacity;
+    scene.firstDirty = UINT32_MAX;
+    for (std::vector<float>* attribute : { &scene.positionX, &scene.positionY, &scene.positionZ, &scene.rotationX, &scene.rotationY, &scene.rotationZ,
+        &scene.rotationW, &scene.scales, &scene.boundsX, &scene.boundsY, &scene.boundsZ, &scene.boundsRadius, &scene.worldScales }) {
+        attribute->reserve(capacity);
+    }
+    scene.parents.reserve(capacity);
+    scene.meshes.reserve(capacity);
+    scene.materials.reserve(capacity);
+    scene.worlds.reserve(capacity);
+    scene.worldSpheres.reserve(capacity);
+    scene.dirty.reserve(capacity);
+    scene.pendingFrames.reserve(capacity);
+
+    // written once per change and never read back, so write combined memory is fine
+    for (VulkanBuffer& buffer : scene.objectBuffers) {
+        createBuffer(context, sizeof(VulkanSceneObject) * (VkDeviceSize)std::max(1u, capacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer);
+    }
+}
+
+void destroyScene(VulkanContext* context, VulkanScene& scene) {
+    for (VulkanBuffer& buffer : scene.objectBuffers) {
+        destroyBuffer(context, buffer);
+    }
+    scene = {};
+}
+
+void markEntityDirty(VulkanScene& scene, uint32_t entity) {
+    scene.dirty[entity] = 1;
+    scene.firstDirty = std::min(scene.firstDirty, entity);
+}
+
+uint32_t addEntity(VulkanScene& scene, uint32_t parent, uint32_t mesh, uint32_t material, const glm::vec4& bounds) {
+    if (scene.count == scene.capacity) {
+        throw std::runtime_error("scene is full!");
+    }
+    if (parent != SCENE_NO_PARENT && parent >= scene.count) {
+        throw std::runtime_error("parent entity doesn't exist!");
+    }
+
+    uint32_t entity = scene.count++;
+    scene.parents.push_back(parent);
+    scene.positionX.push_back(0.0f);
+    scene.positionY.push_back(0.0f);
+    scene.positionZ.push_back(0.0f);
+    scene.rotationX.push_back(0.0f);
+    scene.rotationY.push_back(0.0f);
+    scene.rotationZ.push_back(0.0f);
+    scene.rotationW.push_back(1.0f);
+    scene.scales.push_back(1.0f);
+    scene.boundsX.push_back(bounds.x);
+    scene.boundsY.push_back(bounds.y);
+    scene.boundsZ.push_back(bounds.z);
+    scene.boundsRadius.push_back(bounds.w);
+    scene.meshes.push_back(mesh);
+    scene.materials.push_back(material);
+    scene.worlds.emplace_back(1.0f);
+    scene.worldScales.push_back(1.0f);
+    scene.worldSpheres.emplace_back(0.0f);
+    scene.dirty.push_back(0);
+    scene.pendingFrames.push_back(0);
+    markEntityDirty(scene, entity);
+    return entity;
+}
+
+void setEntityTransform(VulkanScene& scene, uint32_t entity, const glm::vec3& position, const glm::vec4& rotation, float scale) {
+    scene.positionX[entity] = position.x;
+    scene.positionY[entity] = position.y;
+    scene.positionZ[entity] = position.z;
+    scene.rotationX[entity] = rotation.x;
+    scene.rotationY[entity] = rotation.y;
+    scene.rotationZ[entity] = rotation.z;
+    scene.rotationW[entity] = rotation.w;
+    scene.scales[entity] = scale;
+    markEntityDirty(scene, entity);
+}
+
+void setEntityPosition(VulkanScene& scene, uint32_t entity, const glm::vec3& position) {
+    scene.positionX[entity] = position.x;
+    scene.positionY[entity] = position.y;
+    scene.positionZ[entity] = position.z;
+    markEntityDirty(scene, entity);
+}
+
+void setEntityMesh(VulkanScene& scene, uint32_t entity, uint32_t mesh, uint32_t material) {
+    scene.meshes[entity] = mesh;
+    scene.materials[entity] = material;
+    markEntityDirty(scene, entity);
+}
+
+// column major local matrices of up to four entities, built from the rotation, scale and position arrays
+void buildLocalMatrices(const VulkanScene& scene, const uint32_t* entities, uint32_t count, float (*locals)[16]) {
+#ifdef SCENE_SSE2
+    if (count == 4) {
+        // one entity per lane, the gathers are the only part that doesn't run four wide
+        auto gather = [entities](const std::vector<float>& attribute) {
+            return _mm_setr_ps(attribute[entities[0]], attribute[entities[1]], attribute[entities[2]], attribute[entities[3]]);
+        };
+        __m128 x = gather(scene.rotationX);
+        __m128 y = gather(scene.rotationY);
+        __m128 z = gather(scene.rotationZ);
+        __m128 w = gather(scene.rotationW);
+        __m128 scale = gather(scene.scales);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+
+        __m128 xx = _mm_mul_ps(x, x);
+        __m128 yy = _mm_mul_ps(y, y);
+        __m128 zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y);
+        __m128 xz = _mm_mul_ps(x, z);
+        __m128 yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x);
+        __m128 wy = _mm_mul_ps(w, y);
+        __m128 wz = _mm_mul_ps(w, z);
+        __m128 twoScale = _mm_mul_ps(two, scale);
+
+        __m128 columns[4][4];
+        columns[0][0] = _mm_mul_ps(scale, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+        columns[0][1] = _mm_mul_ps(twoScale, _mm_add_ps(xy, wz));
+        columns[0][2] = _mm_mul_ps(twoScale, _mm_sub_ps(xz, wy));
+        columns[0][3] = _mm_setzero_ps();
+        columns[1][0] = _mm_mul_ps(twoScale, _mm_sub_ps(xy, wz));
+        columns[1][1] = _mm_mul_ps(scale, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+        columns[1][2] = _mm_mul_ps(twoScale, _mm_add_ps(yz, wx));
+        columns[1][3] = _mm_setzero_ps();
+        columns[2][0] = _mm_mul_ps(twoScale, _mm_add_ps(xz, wy));
+        columns[2][1] = _mm_mul_ps(twoScale, _mm_sub_ps(yz, wx));
+        columns[2][2] = _mm_mul_ps(scale, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+        columns[2][3] = _mm_setzero_ps();
+        columns[3][0] = gather(scene.positionX);
+        columns[3][1] = gather(scene.positionY);
+        columns[3][2] = gather(scene.positionZ);
+        columns[3][3] = one;
+
+        // from a component per register to a column per entity
+        for (uint32_t column {0}; column < 4; column++) {
+            _MM_TRANSPOSE4_PS(columns[column][0], columns[column][1], columns[column][2], columns[column][3]);
+            for (uint32_t i {0}; i < 4; i++) {
+                _mm_storeu_ps(locals[i] + 4 * column, columns[column][i]);
+            }
+        }
+        return;
+    }
+#endif
+    for (uint32_t i {0}; i < count; i++) {
+        uint32_t entity = entities[i];
+        float x = scene.rotationX[entity];
+        float y = scene.rotationY[entity];
+        float z = scene.rotationZ[entity];
+        float w = scene.rotationW[entity];
+        float scale = scene.scales[entity];
+        float* local = locals[i];
+        local[0] = scale * (1.0f - 2.0f * (y * y + z * z));
+        local[1] = scale * 2.0f * (x * y + w * z);
+        local[2] = scale * 2.0f * (x * z - w * y);
+        local[3] = 0.0f;
+        local[4] = scale * 2.0f * (x * y - w * z);
+        local[5] = scale * (1.0f - 2.0f * (x * x + z * z));
+        local[6] = scale * 2.0f * (y * z + w * x);
+        local[7] = 0.0f;
+        local[8] = scale * 2.0f * (x * z + w * y);
+        local[9] = scale * 2.0f * (y * z - w * x);
+        local[10] = scale * (1.0f - 2.0f * (x * x + y * y));
+        local[11] = 0.0f;
+        local[12] = scene.positionX[entity];
+        local[13] = scene.positionY[entity];
+        local[14] = scene.positionZ[entity];
+        local[15] = 1.0f;
+    }
+}
+
+// result = parent * local, all column major
+void multiplyMatrices(const float* parent, const float* local, float* result) {
+#ifdef SCENE_SSE2
+    __m128 parentColumns[4];
+    for (uint32_t i {0}; i < 4; i++) {
+        parentColumns[i] = _mm_loadu_ps(parent + 4 * i);
+    }
+    for (uint32_t column {0}; column < 4; column++) {
+        const float* source = local + 4 * column;
+        __m128 value = _mm_mul_ps(parentColumns[0], _mm_set1_ps(source[0]));
+        value = _mm_add_ps(value, _mm_mul_ps(parentColumns[1], _mm_set1_ps(source[1])));
+        value = _mm_add_ps(value, _mm_mul_ps(parentColumns[2], _mm_set1_ps(source[2])));
+        value = _mm_add_ps(value, _mm_mul_ps(parentColumns[3], _mm_set1_ps(source[3])));
+        _mm_storeu_ps(result + 4 * column, value);
+    }
+#else
+    for (uint32_t column {0}; column < 4; column++) {
+        for (uint32_t row {0}; row < 4; row++) {
+            float value {0.0f};
+            for (uint32_t k {0}; k < 4; k++) {
+                value += parent[4 * k + row] * local[4 * column + k];
+            }
+            result[4 * column + row] = value;
+        }
+    }
+#endif
+}
+
+uint32_t updateScene(VulkanScene& scene) {
+    std::vector<uint32_t>& updated = scene.updated;
+    updated.clear();
+    // parents come first, so a single pass in order carries dirtiness down whole subtrees
+    for (uint32_t i {scene.firstDirty}; i < scene.count; i++) {
+        uint32_t parent = scene.parents[i];
+        if (parent != SCENE_NO_PARENT && scene.dirty[parent]) {
+            scene.dirty[i] = 1;
+        }
+        if (scene.dirty[i]) {
+            updated.push_back(i);
+        }
+    }
+
+    // in batches of four for the local matrices, the parent multiply then goes in order so parents within a batch are done first
+    float locals[4][16];
+    for (size_t first {0}; first < updated.size(); first += 4) {
+        uint32_t count = (uint32_t)std::min<size_t>(4, updated.size() - first);
+        buildLocalMatrices(scene, updated.data() + first, count, locals);
+        for (uint32_t i {0}; i < count; i++) {
+            uint32_t entity = updated[first + i];
+            uint32_t parent = scene.parents[entity];
+            float* world = &scene.worlds[entity][0][0];
+            if (parent == SCENE_NO_PARENT) {
+                memcpy(world, locals[i], sizeof(locals[i]));
+                scene.worldScales[entity] = scene.scales[entity];
+            } else {
+                multiplyMatrices(&scene.worlds[parent][0][0], locals[i], world);
+                scene.worldScales[entity] = scene.worldScales[parent] * scene.scales[entity];
+            }
+
+            float bx = scene.boundsX[entity];
+            float by = scene.boundsY[entity];
+            float bz = scene.boundsZ[entity];
+            glm::vec4& sphere = scene.worldSpheres[entity];
+            sphere.x = world[0] * bx + world[4] * by + world[8] * bz + world[12];
+            sphere.y = world[1] * bx + world[5] * by + world[9] * bz + world[13];
+            sphere.z = world[2] * bx + world[6] * by + world[10] * bz + world[14];
+            sphere.w = scene.boundsRadius[entity] * scene.worldScales[entity];
+
+            for (uint32_t frame {0}; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+                if (!(scene.pendingFrames[entity] & (1u << frame))) {
+                    scene.pendingObjects[frame].push_back(entity);
+                }
+            }
+            scene.pendingFrames[entity] = ALL_FRAMES_PENDING;
+        }
+    }
+
+    for (uint32_t entity : updated) {
+        scene.dirty[entity] = 0;
+    }
+    scene.firstDirty = UINT32_MAX;
+    return (uint32_t)updated.size();
+}
+
+uint32_t writeSceneObjects(VulkanScene& scene, const VulkanFrame& frame) {
+    std::vector<uint32_t>& pending = scene.pendingObjects[frame.index];
+    VulkanSceneObject* objects = (VulkanSceneObject*)scene.objectBuffers[frame.index].allocation.mapped;
+    uint8_t frameBit = (uint8_t)(1u << frame.index);
+    for (uint32_t entity : pending) {
+        // assembled on the stack and copied whole, the mapping may be uncached
+        VulkanSceneObject object;
+        object.world = scene.worlds[entity];
+        object.sphere = scene.worldSpheres[entity];
+        object.mesh = scene.meshes[entity];
+        object.material = scene.materials[entity];
+        object.padding[0] = 0;
+        object.padding[1] = 0;
+        memcpy(objects + entity, &object, sizeof(object));
+        scene.pendingFrames[entity] &= (uint8_t)~frameBit;
+    }
+    uint32_t written = (uint32_t)pending.size();
+    pending.clear();
+    return written;
+}
+
+void addSceneInstances(const VulkanScene& scene, VulkanDrawList& drawList) {
+    for (uint32_t entity {0}; entity < scene.count; entity++) {
+        if (scene.meshes[entity] == UINT32_MAX) {
+            continue;
+        }
+        const glm::mat4& world = scene.worlds[entity];
+        Instance instance;
+        instance.position = glm::vec3(world[3].x, world[3].y, world[3].z);
+        instance.scale = scene.worldScales[entity];
+        addInstance(drawList, scene.meshes[entity], instance);
+    }
+}
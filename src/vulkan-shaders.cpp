@@ -0,0 +1,203 @@
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include "vulkan-base.h"
+
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const double SHADER_POLL_INTERVAL = 0.25;
+
+struct ShaderModuleEntry {
+    VkShaderModule module;
+    VulkanShaderReflection reflection;
+    uint32_t references;
+    // no file has this code anymore, destroyed once the last pipeline using it is created
+    bool stale;
+};
+
+struct ShaderFile {
+    uint64_t codeHash;
+    std::filesystem::file_time_type writeTime;
+    // a change is only picked up once the write time held still for a poll, so half written files are skipped
+    std::filesystem::file_time_type pendingWriteTime;
+};
+
+struct VulkanShaderLibrary {
+    std::mutex mutex;
+    std::unordered_map<std::string, ShaderFile> files;
+    // keyed by a hash of the code, files with identical spir-v share a module
+    std::unordered_map<uint64_t, ShaderModuleEntry> modules;
+    std::chrono::steady_clock::time_point lastPoll;
+};
+
+uint64_t hashShaderCode(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i {0}; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// whole words, aligned and starting with the header, anything else is a torn write or not spir-v at all
+bool isValidSpirv(const VulkanMappedFile& mapped) {
+    if (mapped.size < 5 * sizeof(uint32_t) || mapped.size % sizeof(uint32_t) != 0 || (uintptr_t)mapped.data % alignof(uint32_t) != 0) {
+        return false;
+    }
+    return ((const uint32_t*)mapped.data)[0] == SPIRV_MAGIC;
+}
+
+// maps the file and makes sure a module for its code exists, expects the library mutex to be held
+bool loadShaderFile(VulkanContext* context, const std::string& filename, uint64_t& codeHash) {
+    VulkanShaderLibrary* library = context->shaderLibrary;
+    VulkanMappedFile mapped;
+    if (!mapFile(filename, mapped)) {
+        LOG(LOG_ERROR_UTILS, false, "shader-library: could not map %s", filename.c_str());
+        return false;
+    }
+    if (!isValidSpirv(mapped)) {
+        LOG(LOG_ERROR_UTILS, false, "shader-library: %s is not valid spir-v (%zu bytes)", filename.c_str(), mapped.size);
+        unmapFile(mapped);
+        return false;
+    }
+
+    codeHash = hashShaderCode(mapped.data, mapped.size);
+    auto it = library->modules.find(codeHash);
+    if (it == library->modules.end()) {
+        VulkanShaderReflection reflection;
+        try {
+            reflectShader((const uint32_t*)mapped.data, mapped.size / sizeof(uint32_t), reflection);
+        } catch(std::exception& exception) {
+            LOG(LOG_ERROR_UTILS, false, "shader-library: could not reflect %s: %s", filename.c_str(), exception.what());
+            unmapFile(mapped);
+            return false;
+        }
+
+        VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+        createInfo.codeSize = mapped.size;
+        createInfo.pCode = (const uint32_t*)mapped.data;
+        VkShaderModule module;
+        VkResult result = vkCreateShaderModule(context->device, &createInfo, 0, &module);
+        unmapFile(mapped);
+        VAC(result);
+        library->modules[codeHash] = { module, reflection, 0, false };
+    } else {
+        unmapFile(mapped);
+        it->second.stale = false;
+    }
+    return true;
+}
+
+void createShaderLibrary(VulkanContext* context) {
+    VulkanShaderLibrary* library = new VulkanShaderLibrary {};
+    library->lastPoll = std::chrono::steady_clock::now();
+    context->shaderLibrary = library;
+}
+
+void destroyShaderLibrary(VulkanContext* context) {
+    VulkanShaderLibrary* library = context->shaderLibrary;
+    for (auto& [hash, entry] : library->modules) {
+        vkDestroyShaderModule(context->device, entry.module, 0);
+    }
+    delete library;
+    context->shaderLibrary = nullptr;
+}
+
+VkShaderModule acquireShaderModule(VulkanContext* context, const std::string& filename, VulkanShaderReflection* reflection) {
+    VulkanShaderLibrary* library = context->shaderLibrary;
+    std::lock_guard<std::mutex> lock(library->mutex);
+
+    auto file = library->files.find(filename);
+    if (file == library->files.end()) {
+        ShaderFile shaderFile = {};
+        std::error_code error;
+        shaderFile.writeTime = std::filesystem::last_write_time(filename, error);
+        shaderFile.pendingWriteTime = shaderFile.writeTime;
+        if (error || !loadShaderFile(context, filename, shaderFile.codeHash)) {
+            throw std::runtime_error("failed to load shader " + filename);
+        }
+        file = library->files.emplace(filename, shaderFile).first;
+    }
+
+    ShaderModuleEntry& entry = library->modules[file->second.codeHash];
+    entry.references++;
+    if (reflection) {
+        *reflection = entry.reflection;
+    }
+    return entry.module;
+}
+
+void releaseShaderModule(VulkanContext* context, VkShaderModule module) {
+    VulkanShaderLibrary* library = context->shaderLibrary;
+    std::lock_guard<std::mutex> lock(library->mutex);
+    for (auto it = library->modules.begin(); it != library->modules.end(); it++) {
+        if (it->second.module != module) {
+            continue;
+        }
+        it->second.references--;
+        // pipelines don't need their modules once created, so nothing on the gpu can still use it
+        if (it->second.stale && it->second.references == 0) {
+            vkDestroyShaderModule(context->device, module, 0);
+            library->modules.erase(it);
+        }
+        return;
+    }
+}
+
+uint32_t pollShaderLibrary(VulkanContext* context) {
+    VulkanShaderLibrary* library = context->shaderLibrary;
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - library->lastPoll).count() < SHADER_POLL_INTERVAL) {
+        return 0;
+    }
+    library->lastPoll = now;
+
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(library->mutex);
+        for (auto& [filename, file] : library->files) {
+            std::error_code error;
+            auto writeTime = std::filesystem::last_write_time(filename, error);
+            if (error || writeTime == file.writeTime) {
+                continue;
+            }
+            if (writeTime != file.pendingWriteTime) {
+                file.pendingWriteTime = writeTime;
+                continue;
+            }
+
+            uint64_t codeHash;
+            if (!loadShaderFile(context, filename, codeHash)) {
+                // keeps the old code, a later write triggers another attempt
+                file.writeTime = writeTime;
+                continue;
+            }
+            file.writeTime = writeTime;
+            if (codeHash == file.codeHash) {
+                continue;
+            }
+
+            uint64_t oldHash = file.codeHash;
+            file.codeHash = codeHash;
+            bool shared = false;
+            for (auto& [otherName, other] : library->files) {
+                shared = shared || other.codeHash == oldHash;
+            }
+            auto old = library->modules.find(oldHash);
+            if (!shared && old != library->modules.end()) {
+                old->second.stale = true;
+                if (old->second.references == 0) {
+                    vkDestroyShaderModule(context->device, old->second.module, 0);
+                    library->modules.erase(old);
+                }
+            }
+            changed.push_back(filename);
+        }
+    }
+
+    // outside the lock, the rebuilds acquire the new modules from the thread pool
+    for (auto& filename : changed) {
+        uint32_t pipelineCount = reloadPipelines(context, filename);
+        LOG(LOG_DEFAULT_UTILS, false, "shader-library: %s changed, rebuilding %u pipelines", filename.c_str(), pipelineCount);
+    }
+    return (uint32_t)changed.size();
+}
@@ -1,7 +1,47 @@
+#include <algorithm>
 #include "vulkan-base.h"
 
-void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage, VulkanSwapchain& swapchain) {    
+const uint64_t PRESENT_WAIT_TIMEOUT = 100ull * 1000 * 1000;
+
+PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+
+VkSurfaceFormatKHR chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
+    for (auto& availableFormat : availableFormats) {
+        if ((availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM || availableFormat.format == VK_FORMAT_R8G8B8A8_UNORM)
+            && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            return availableFormat;
+        }
+    }
+    return availableFormats[0];
+}
+
+VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& availableModes, VulkanPresentPolicy policy) {
+    std::vector<VkPresentModeKHR> preferred;
+    switch (policy) {
+        case PRESENT_POLICY_ADAPTIVE_VSYNC:
+            preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            break;
+        case PRESENT_POLICY_LOW_LATENCY:
+            preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+            break;
+        case PRESENT_POLICY_THROUGHPUT:
+            preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            break;
+        default:
+            break;
+    }
+    for (auto mode : preferred) {
+        if (std::find(availableModes.begin(), availableModes.end(), mode) != availableModes.end()) {
+            return mode;
+        }
+    }
+    // the only mode every surface has to support
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageFlags usage, VulkanSwapchain& swapchain, VulkanPresentPolicy policy, VkSwapchainKHR oldSwapchain) {    
     swapchain = {};
+    swapchain.policy = policy;
     VkBool32 supportsPresent = 0;
     vkGetPhysicalDeviceSurfaceSupportKHR(context->physicalDevice, context->graphicsQueue.familyIndex, surface, &supportsPresent);
     if (!supportsPresent) {
@@ -18,8 +58,15 @@ void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageF
         return;
     }
 
-    VkFormat format = availableFormats[0].format;
-    VkColorSpaceKHR colorSpace = availableFormats[0].colorSpace;
+    VkSurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(availableFormats);
+    VkFormat format = surfaceFormat.format;
+    VkColorSpaceKHR colorSpace = surfaceFormat.colorSpace;
+
+    uint32_t numPresentModes {0};
+    vkGetPhysicalDeviceSurfacePresentModesKHR(context->physicalDevice, surface, &numPresentModes, 0);
+    std::vector<VkPresentModeKHR> availablePresentModes(numPresentModes);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(context->physicalDevice, surface, &numPresentModes, availablePresentModes.data());
+    VkPresentModeKHR presentMode = choosePresentMode(availablePresentModes, policy);
 
     VkSurfaceCapabilitiesKHR surfaceCapabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context->physicalDevice, surface, &surfaceCapabilities);
@@ -33,9 +80,15 @@ void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageF
         surfaceCapabilities.currentExtent.height = surfaceCapabilities.minImageExtent.height;
     }
 
+    // mailbox needs a spare image to replace, fifo queues one more than the minimum so acquire rarely blocks
+    uint32_t imageCount = std::max(surfaceCapabilities.minImageCount + 1, presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3u : 2u);
+    if (surfaceCapabilities.maxImageCount > 0) {
+        imageCount = std::min(imageCount, surfaceCapabilities.maxImageCount);
+    }
+
     VkSwapchainCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
     createInfo.surface = surface;
-    createInfo.minImageCount = 3;
+    createInfo.minImageCount = imageCount;
     createInfo.imageFormat = format;
     createInfo.imageColorSpace = colorSpace;
     createInfo.imageExtent = surfaceCapabilities.currentExtent;
@@ -44,10 +97,16 @@ void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageF
     createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     createInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    createInfo.presentMode = presentMode;
+    createInfo.oldSwapchain = oldSwapchain;
 
     VAC(vkCreateSwapchainKHR(context->device, &createInfo, 0, &swapchain.swapchain));
 
+    swapchain.presentMode = presentMode;
+    if (context->features.presentWait && !waitForPresent) {
+        waitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(context->device, "vkWaitForPresentKHR");
+    }
+
     swapchain.format = format;
     swapchain.width = surfaceCapabilities.currentExtent.width;
     swapchain.height = surfaceCapabilities.currentExtent.height;
@@ -58,6 +117,7 @@ void createSwapchain(VulkanContext* context, VkSurfaceKHR surface, VkImageUsageF
     vkGetSwapchainImagesKHR(context->device, swapchain.swapchain, &numImages, swapchain.images.data());
 
     swapchain.imageViews.resize(numImages);
+    LOG(LOG_DEFAULT_UTILS, false, "swapchain: %u images, present mode %d", numImages, (int)presentMode);
     for (size_t i {0}; i < numImages; i++) {
         VkImageViewCreateInfo createInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
         createInfo.image = swapchain.images[i];
@@ -79,6 +139,38 @@ void destroySwapchain(VulkanContext* context, VulkanSwapchain* swapchain, std::v
     vkDestroySwapchainKHR(context->device, swapchain->swapchain, 0);
 }
 
+VkResult presentSwapchain(VulkanContext* context, VulkanSwapchain& swapchain, uint32_t imageIndex, VkSemaphore waitSemaphore, double inputTime) {
+    VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &swapchain.swapchain;
+    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &waitSemaphore;
+
+    VkPresentIdKHR presentIdInfo = { VK_STRUCTURE_TYPE_PRESENT_ID_KHR };
+    uint64_t presentId = swapchain.presentId + 1;
+    if (waitForPresent) {
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &presentId;
+        presentInfo.pNext = &presentIdInfo;
+        swapchain.presentId = presentId;
+        swapchain.inputTimes[presentId % swapchain.inputTimes.size()] = inputTime;
+    }
+    return vkQueuePresentKHR(context->graphicsQueue.queue, &presentInfo);
+}
+
+double pacePresents(VulkanContext* context, VulkanSwapchain& swapchain, uint32_t maxQueuedPresents) {
+    if (!waitForPresent || swapchain.presentId <= maxQueuedPresents) {
+        return -1.0;
+    }
+    uint64_t presentId = swapchain.presentId - maxQueuedPresents;
+    // a timeout (e.g. minimized window) skips pacing for this frame instead of stalling it
+    if (waitForPresent(context->device, swapchain.swapchain, presentId, PRESENT_WAIT_TIMEOUT) != VK_SUCCESS) {
+        return -1.0;
+    }
+    return (glfwGetTime() - swapchain.inputTimes[presentId % swapchain.inputTimes.size()]) * 1000.0;
+}
+
 void recreateSwapchain(GLFWwindow* window, VulkanContext* context, VulkanSwapchain& swapchain, std::vector<VkFramebuffer>& framebuffers, VkSurfaceKHR& surface, VkRenderPass& renderPass) {
     int width {0}, height {0};
     glfwGetFramebufferSize(window, &width, &height);
@@ -87,8 +179,17 @@ void recreateSwapchain(GLFWwindow* window, VulkanContext* context, VulkanSwapcha
         glfwWaitEvents();
     }
     
-    vkDeviceWaitIdle(context->device);
-    destroySwapchain(context, &swapchain, framebuffers);
-    createSwapchain(context, surface, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, swapchain);
-    createFramebuffers(context, swapchain, renderPass, framebuffers);
+    VulkanSwapchain oldSwapchain = swapchain;
+    std::vector<VkFramebuffer> oldFramebuffers;
+    oldFramebuffers.swap(framebuffers);
+    createSwapchain(context, surface, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, swapchain, oldSwapchain.policy, oldSwapchain.swapchain);
+    // dynamic rendering has no framebuffers to rebuild
+    if (renderPass != VK_NULL_HANDLE) {
+        createFramebuffers(context, swapchain, renderPass, framebuffers);
+    }
+
+    // the retired swapchain can't be acquired from anymore, only frames still in flight reference it
+    deferDeletion(context, [context, oldSwapchain, oldFramebuffers]() mutable {
+        destroySwapchain(context, &oldSwapchain, oldFramebuffers);
+    });
 }
\ No newline at end of file
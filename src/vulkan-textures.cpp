@@ -0,0 +1,594 @@
+#include <algorithm>
+#include <atomic>
+#include "vulkan-base.h"
+#include "thread-pool.h"
+
+// the coarse levels that fit in here are always resident, so every loaded texture can be drawn
+const VkDeviceSize TEXTURE_TAIL_SIZE = 64 * 1024;
+// textures not touched for this many updates stop streaming in finer levels
+const uint64_t TEXTURE_IDLE_UPDATES = 120;
+const uint32_t KTX2_MAX_LEVELS = 16;
+const uint8_t KTX2_IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+enum TextureLoadState {
+    TEXTURE_LOAD_PENDING,
+    // validated, the worker is still faulting in the finer levels
+    TEXTURE_LOAD_STREAMING,
+    TEXTURE_LOAD_READY,
+    TEXTURE_LOAD_FAILED
+};
+
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "the ktx2 header can't have padding");
+// level 0 is the full resolution one, the data itself is stored smallest first
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+struct StreamedTexture {
+    std::string filename;
+    // only touched by the worker until the state leaves pending
+    VulkanMappedFile mapped;
+    std::string error;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    // the levels before it don't fit the upload ring and never become resident
+    uint32_t firstUsableLevel;
+    uint32_t tailLevel;
+    Ktx2Level levels[KTX2_MAX_LEVELS];
+    std::atomic<uint32_t> state;
+    // finest level the worker faulted in, only levels from there on are copied out of the mapping
+    std::atomic<uint32_t> availableLevel;
+    std::atomic<bool> cancelled;
+
+    // the image holds the file levels [residentLevel, levelCount), residentLevel is levelCount while nothing is resident
+    VulkanImage image;
+    uint32_t residentLevel;
+    uint32_t bindlessIndex;
+    uint64_t lastUsed;
+    uint32_t wantedLevel;
+    bool unloaded;
+};
+
+struct VulkanTextureStreamer {
+    // handles index into it, unloaded slots are reused
+    std::vector<StreamedTexture*> textures;
+    std::vector<uint32_t> freeHandles;
+    VkSampler sampler;
+    VkDeviceSize budget;
+    VkDeviceSize residentBytes;
+    uint64_t updateNumber;
+    uint64_t streamedBytes;
+    uint32_t evictedMips;
+};
+
+// block size and bytes per block of the formats the streamer accepts
+bool getTextureFormatBlock(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes) {
+    blockWidth = 4;
+    blockHeight = 4;
+    blockBytes = 16;
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            blockWidth = 1;
+            blockHeight = 1;
+            blockBytes = 4;
+            return true;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            blockBytes = 8;
+            return true;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+            return true;
+        case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+            blockWidth = 5;
+            return true;
+        case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+            blockWidth = 5;
+            blockHeight = 5;
+            return true;
+        case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+            blockWidth = 6;
+            blockHeight = 5;
+            return true;
+        case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+            blockWidth = 6;
+            blockHeight = 6;
+            return true;
+        case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+            blockWidth = 8;
+            blockHeight = 5;
+            return true;
+        case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+            blockWidth = 8;
+            blockHeight = 6;
+            return true;
+        case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+            blockWidth = 8;
+            blockHeight = 8;
+            return true;
+        case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+            blockWidth = 10;
+            blockHeight = 5;
+            return true;
+        case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+            blockWidth = 10;
+            blockHeight = 6;
+            return true;
+        case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+            blockWidth = 10;
+            blockHeight = 8;
+            return true;
+        case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+            blockWidth = 10;
+            blockHeight = 10;
+            return true;
+        case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+            blockWidth = 12;
+            blockHeight = 10;
+            return true;
+        case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+            blockWidth = 12;
+            blockHeight = 12;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// bc and astc each come as a whole family behind one feature, sampling them filtered is checked on top
+bool isTextureFormatSupported(VulkanContext* context, VkFormat format) {
+    bool bc = format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+    bool astc = format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+    if ((bc && !context->features.textureCompressionBC) || (astc && !context->features.textureCompressionASTC)) {
+        return false;
+    }
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(context->physicalDevice, format, &properties);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+// everything the streamer reads later is checked here, so a bad file fails its load instead of an upload
+bool parseKtx2(VulkanContext* context, StreamedTexture* texture) {
+    const VulkanMappedFile& mapped = texture->mapped;
+    if (mapped.size < sizeof(Ktx2Header)) {
+        texture->error = "too small for a ktx2 header";
+        return false;
+    }
+    Ktx2Header header;
+    memcpy(&header, mapped.data, sizeof(header));
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        texture->error = "not a ktx2 file";
+        return false;
+    }
+    if (header.supercompressionScheme != 0) {
+        texture->error = "supercompressed files aren't supported, transcode them offline";
+        return false;
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1) {
+        texture->error = "only single 2d images are supported";
+        return false;
+    }
+
+    VkFormat format = (VkFormat)header.vkFormat;
+    uint32_t blockWidth, blockHeight, blockBytes;
+    if (!getTextureFormatBlock(format, blockWidth, blockHeight, blockBytes)) {
+        texture->error = "unsupported format " + std::to_string(header.vkFormat);
+        return false;
+    }
+    if (!isTextureFormatSupported(context, format)) {
+        texture->error = "format " + std::to_string(header.vkFormat) + " can't be sampled on this device";
+        return false;
+    }
+
+    // 0 asks the loader to generate mips, only the base level is stored then
+    uint32_t levelCount = std::max(1u, header.levelCount);
+    uint32_t fullChain {1};
+    while ((std::max(header.pixelWidth, header.pixelHeight) >> fullChain) > 0) {
+        fullChain++;
+    }
+    if (levelCount > fullChain || levelCount > KTX2_MAX_LEVELS) {
+        texture->error = "invalid level count " + std::to_string(levelCount);
+        return false;
+    }
+    if (mapped.size < sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level)) {
+        texture->error = "truncated level index";
+        return false;
+    }
+    memcpy(texture->levels, mapped.data + sizeof(Ktx2Header), levelCount * sizeof(Ktx2Level));
+    for (uint32_t i {0}; i < levelCount; i++) {
+        const Ktx2Level& level = texture->levels[i];
+        uint64_t blocksX = (std::max(1u, header.pixelWidth >> i) + blockWidth - 1) / blockWidth;
+        uint64_t blocksY = (std::max(1u, header.pixelHeight >> i) + blockHeight - 1) / blockHeight;
+        if (level.byteLength != blocksX * blocksY * blockBytes || level.byteOffset > mapped.size || level.byteLength > mapped.size - level.byteOffset) {
+            texture->error = "level " + std::to_string(i) + " is truncated or has the wrong size";
+            return false;
+        }
+    }
+
+    texture->format = format;
+    texture->width = header.pixelWidth;
+    texture->height = header.pixelHeight;
+    texture->levelCount = levelCount;
+    texture->firstUsableLevel = 0;
+    while (texture->firstUsableLevel < levelCount && texture->levels[texture->firstUsableLevel].byteLength > UPLOAD_RING_SIZE / 2) {
+        texture->firstUsableLevel++;
+    }
+    if (texture->firstUsableLevel == levelCount) {
+        texture->error = "even the smallest level doesn't fit the upload ring";
+        return false;
+    }
+    texture->tailLevel = levelCount - 1;
+    VkDeviceSize tailBytes = texture->levels[texture->tailLevel].byteLength;
+    while (texture->tailLevel > texture->firstUsableLevel && tailBytes + texture->levels[texture->tailLevel - 1].byteLength <= TEXTURE_TAIL_SIZE) {
+        texture->tailLevel--;
+        tailBytes += texture->levels[texture->tailLevel].byteLength;
+    }
+    return true;
+}
+
+VkDeviceSize getLevelBytes(const StreamedTexture* texture, uint32_t firstLevel) {
+    VkDeviceSize bytes {0};
+    for (uint32_t i {firstLevel}; i < texture->levelCount; i++) {
+        bytes += texture->levels[i].byteLength;
+    }
+    return bytes;
+}
+
+void releaseTextureImage(VulkanContext* context, VulkanFrame& frame, VulkanTextureStreamer* streamer, StreamedTexture* texture) {
+    if (texture->bindlessIndex != UINT32_MAX) {
+        releaseBindlessTexture(context, frame, texture->bindlessIndex);
+        texture->bindlessIndex = UINT32_MAX;
+    }
+    if (texture->image.image != VK_NULL_HANDLE) {
+        streamer->residentBytes -= texture->image.allocation.size;
+        deferDestroyImage(context, texture->image);
+    }
+    texture->residentLevel = texture->levelCount;
+}
+
+// recreates the image with the file levels [level, levelCount) read straight from the mapping, the old image and slot retire with the frame
+// without sparse residency that is the only way to change which mips are resident, returns the bytes uploaded
+VkDeviceSize rebuildTexture(VulkanContext* context, VulkanFrame& frame, VulkanTextureStreamer* streamer, StreamedTexture* texture, uint32_t level) {
+    VulkanImage image;
+    createImage(context, std::max(1u, texture->width >> level), std::max(1u, texture->height >> level), texture->levelCount - level, texture->format,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, image);
+    VkDeviceSize uploaded {0};
+    for (uint32_t i {level}; i < texture->levelCount; i++) {
+        const Ktx2Level& source = texture->levels[i];
+        uploadImage(context, image, i - level, texture->mapped.data + source.byteOffset, source.byteLength, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uploaded += source.byteLength;
+    }
+
+    releaseTextureImage(context, frame, streamer, texture);
+    texture->image = image;
+    texture->residentLevel = level;
+    if (context->bindless) {
+        texture->bindlessIndex = addBindlessTexture(context, image.imageView, streamer->sampler);
+    }
+    streamer->residentBytes += image.allocation.size;
+    streamer->streamedBytes += uploaded;
+    return uploaded;
+}
+
+// least recently used texture that still has a level above its tail, textures used at usedBefore or later are spared
+StreamedTexture* findEvictionVictim(VulkanTextureStreamer* streamer, uint64_t usedBefore) {
+    StreamedTexture* victim = nullptr;
+    for (StreamedTexture* texture : streamer->textures) {
+        if (!texture || texture->unloaded || texture->image.image == VK_NULL_HANDLE || texture->lastUsed >= usedBefore || texture->residentLevel >= texture->tailLevel) {
+            continue;
+        }
+        if (!victim || texture->lastUsed < victim->lastUsed || (texture->lastUsed == victim->lastUsed && texture->residentLevel < victim->residentLevel)) {
+            victim = texture;
+        }
+    }
+    return victim;
+}
+
+bool wantsFinerLevel(const VulkanTextureStreamer* streamer, const StreamedTexture* texture) {
+    if (texture->residentLevel == texture->levelCount) {
+        return true;
+    }
+    uint32_t finest = std::max(texture->wantedLevel, texture->firstUsableLevel);
+    return texture->residentLevel > finest && texture->lastUsed + TEXTURE_IDLE_UPDATES >= streamer->updateNumber;
+}
+
+void freeTexture(VulkanTextureStreamer* streamer, uint32_t handle) {
+    StreamedTexture* texture = streamer->textures[handle];
+    if (texture->mapped.data) {
+        unmapFile(texture->mapped);
+    }
+    delete texture;
+    streamer->textures[handle] = nullptr;
+    streamer->freeHandles.push_back(handle);
+}
+
+void createTextureStreamer(VulkanContext* context, VkDeviceSize budget) {
+    VulkanTextureStreamer* streamer = new VulkanTextureStreamer {};
+
+    VkSamplerCreateInfo samplerInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VAC(vkCreateSampler(context->device, &samplerInfo, 0, &streamer->sampler));
+
+    context->textureStreamer = streamer;
+    setTextureBudget(context, budget);
+}
+
+void destroyTextureStreamer(VulkanContext* context) {
+    VulkanTextureStreamer* streamer = context->textureStreamer;
+    for (StreamedTexture* texture : streamer->textures) {
+        if (texture) {
+            texture->cancelled = true;
+        }
+    }
+    // workers still faulting in levels hold on to their textures
+    context->threadPool->wait();
+    for (uint32_t handle {0}; handle < streamer->textures.size(); handle++) {
+        StreamedTexture* texture = streamer->textures[handle];
+        if (!texture) {
+            continue;
+        }
+        if (texture->image.image != VK_NULL_HANDLE) {
+            destroyImage(context, texture->image);
+        }
+        freeTexture(streamer, handle);
+    }
+    vkDestroySampler(context->device, streamer->sampler, 0);
+    delete streamer;
+    context->textureStreamer = nullptr;
+}
+
+// a smaller budget is enforced by the next updates, which evict until resident textures fit again
+void setTextureBudget(VulkanContext* context, VkDeviceSize budget) {
+    if (budget == 0) {
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &memoryProperties);
+        for (uint32_t i {0}; i < memoryProperties.memoryHeapCount; i++) {
+            if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                budget = std::max(budget, memoryProperties.memoryHeaps[i].size / 2);
+            }
+        }
+    }
+    context->textureStreamer->budget = budget;
+}
+
+uint32_t loadTexture(VulkanContext* context, const std::string& filename) {
+    VulkanTextureStreamer* streamer = context->textureStreamer;
+    StreamedTexture* texture = new StreamedTexture {};
+    texture->filename = filename;
+    texture->state = TEXTURE_LOAD_PENDING;
+    texture->bindlessIndex = UINT32_MAX;
+    texture->lastUsed = streamer->updateNumber;
+
+    uint32_t handle;
+    if (!streamer->freeHandles.empty()) {
+        handle = streamer->freeHandles.back();
+        streamer->freeHandles.pop_back();
+        streamer->textures[handle] = texture;
+    } else {
+        handle = (uint32_t)streamer->textures.size();
+        streamer->textures.push_back(texture);
+    }
+
+    context->threadPool->submit([context, texture](uint32_t) {
+        if (!mapFile(texture->filename, texture->mapped)) {
+            texture->error = "could not map the file";
+            texture->state.store(TEXTURE_LOAD_FAILED, std::memory_order_release);
+            return;
+        }
+        if (!parseKtx2(context, texture)) {
+            texture->state.store(TEXTURE_LOAD_FAILED, std::memory_order_release);
+            return;
+        }
+        texture->residentLevel = texture->levelCount;
+        texture->availableLevel.store(texture->levelCount, std::memory_order_relaxed);
+        texture->state.store(TEXTURE_LOAD_STREAMING, std::memory_order_release);
+
+        // coarse to fine, so the tail can go up while the large levels are still on their way from disk
+        for (uint32_t level {texture->levelCount}; level-- > texture->firstUsableLevel && !texture->cancelled.load(std::memory_order_relaxed);) {
+            prefetchFile(texture->mapped, (size_t)texture->levels[level].byteOffset, (size_t)texture->levels[level].byteLength);
+            texture->availableLevel.store(level, std::memory_order_release);
+        }
+        texture->state.store(TEXTURE_LOAD_READY, std::memory_order_release);
+    });
+    return handle;
+}
+
+// the gpu side retires with the frame right away, the rest once the worker let go of it
+void unloadTexture(VulkanContext* context, VulkanFrame& frame, uint32_t texture) {
+    VulkanTextureStreamer* streamer = context->textureStreamer;
+    StreamedTexture* streamed = streamer->textures[texture];
+    streamed->unloaded = true;
+    streamed->cancelled = true;
+    uint32_t state = streamed->state.load(std::memory_order_acquire);
+    if (state == TEXTURE_LOAD_STREAMING || state == TEXTURE_LOAD_READY) {
+        releaseTextureImage(context, frame, streamer, streamed);
+    }
+    if (state == TEXTURE_LOAD_READY || state == TEXTURE_LOAD_FAILED) {
+        freeTexture(streamer, texture);
+    }
+}
+
+void touchTexture(VulkanContext* context, uint32_t texture, uint32_t finestMip) {
+    VulkanTextureStreamer* streamer = context->textureStreamer;
+    StreamedTexture* streamed = streamer->textures[texture];
+    // several draws in one frame want the sharpest level any of them needs
+    if (streamed->lastUsed == streamer->updateNumber) {
+        streamed->wantedLevel = std::min(streamed->wantedLevel, finestMip);
+    } else {
+        streamed->wantedLevel = finestMip;
+    }
+    streamed->lastUsed = streamer->updateNumber;
+}
+
+uint32_t updateTextureStreaming(VulkanContext* context, VulkanFrame& frame, VkDeviceSize byteBudget) {
+    VulkanTextureStreamer* streamer = context->textureStreamer;
+    std::vector<StreamedTexture*> candidates;
+    for (uint32_t handle {0}; handle < streamer->textures.size(); handle++) {
+        StreamedTexture* texture = streamer->textures[handle];
+        if (!texture) {
+            continue;
+        }
+        uint32_t state = texture->state.load(std::memory_order_acquire);
+        if (texture->unloaded) {
+            if (state == TEXTURE_LOAD_READY || state == TEXTURE_LOAD_FAILED) {
+                freeTexture(streamer, handle);
+            }
+            continue;
+        }
+        if (state == TEXTURE_LOAD_FAILED && !texture->error.empty()) {
+            // the handle stays valid and never gets a view, the mapping isn't needed anymore
+            LOG(LOG_ERROR_UTILS, false, "texture-streaming: %s: %s", texture->filename.c_str(), texture->error.c_str());
+            texture->error.clear();
+            if (texture->mapped.data) {
+                unmapFile(texture->mapped);
+            }
+        }
+        if ((state == TEXTURE_LOAD_STREAMING || state == TEXTURE_LOAD_READY) && wantsFinerLevel(streamer, texture)) {
+            candidates.push_back(texture);
+        }
+    }
+
+    uint32_t changed {0};
+    VkDeviceSize uploaded {0};
+    // a lowered budget shrinks everything down to the tails, least recently used first
+    while (streamer->residentBytes > streamer->budget && uploaded < byteBudget) {
+        StreamedTexture* victim = findEvictionVictim(streamer, UINT64_MAX);
+        if (!victim) {
+            break;
+        }
+        uploaded += rebuildTexture(context, frame, streamer, victim, victim->residentLevel + 1);
+        streamer->evictedMips++;
+        changed++;
+    }
+
+    // textures without anything resident first, then the most recently used, coarsest first so all of them sharpen together
+    std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+        bool aEmpty = a->residentLevel == a->levelCount;
+        bool bEmpty = b->residentLevel == b->levelCount;
+        if (aEmpty != bEmpty) {
+            return aEmpty;
+        }
+        if (a->lastUsed != b->lastUsed) {
+            return a->lastUsed > b->lastUsed;
+        }
+        return a->residentLevel > b->residentLevel;
+    });
+
+    for (StreamedTexture* texture : candidates) {
+        if (uploaded >= byteBudget) {
+            break;
+        }
+        bool tail = texture->residentLevel == texture->levelCount;
+        uint32_t level = tail ? texture->tailLevel : texture->residentLevel - 1;
+        if (texture->availableLevel.load(std::memory_order_acquire) > level) {
+            continue;
+        }
+
+        // tails are always granted, beyond them only textures used less recently give up their finest levels
+        VkDeviceSize otherBytes = streamer->residentBytes - texture->image.allocation.size;
+        VkDeviceSize required = getLevelBytes(texture, level);
+        while (!tail && otherBytes + required > streamer->budget && uploaded < byteBudget) {
+            StreamedTexture* victim = findEvictionVictim(streamer, texture->lastUsed);
+            if (!victim) {
+                break;
+            }
+            uploaded += rebuildTexture(context, frame, streamer, victim, victim->residentLevel + 1);
+            streamer->evictedMips++;
+            changed++;
+            otherBytes = streamer->residentBytes - texture->image.allocation.size;
+        }
+        if (!tail && otherBytes + required > streamer->budget) {
+            continue;
+        }
+        uploaded += rebuildTexture(context, frame, streamer, texture, level);
+        changed++;
+    }
+
+    streamer->updateNumber++;
+    return changed;
+}
+
+VkImageView getTextureView(VulkanContext* context, uint32_t texture) {
+    return context->textureStreamer->textures[texture]->image.imageView;
+}
+
+uint32_t getTextureIndex(VulkanContext* context, uint32_t texture) {
+    return context->textureStreamer->textures[texture]->bindlessIndex;
+}
+
+VkSampler getTextureSampler(VulkanContext* context) {
+    return context->textureStreamer->sampler;
+}
+
+void getTextureStats(VulkanContext* context, VulkanTextureStats& stats) {
+    VulkanTextureStreamer* streamer = context->textureStreamer;
+    stats = {};
+    for (StreamedTexture* texture : streamer->textures) {
+        if (!texture || texture->unloaded) {
+            continue;
+        }
+        stats.textureCount++;
+        stats.residentMips += texture->image.mipLevels;
+    }
+    stats.residentBytes = streamer->residentBytes;
+    stats.budget = streamer->budget;
+    stats.streamedBytes = streamer->streamedBytes;
+    stats.evictedMips = streamer->evictedMips;
+}
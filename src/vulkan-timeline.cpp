@@ -0,0 +1,30 @@
+#include "vulkan-base.h"
+
+void createTimeline(VulkanContext* context, VulkanQueue& queue) {
+    VkSemaphoreTypeCreateInfo typeInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo createInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    createInfo.pNext = &typeInfo;
+    VAC(vkCreateSemaphore(context->device, &createInfo, 0, &queue.timeline));
+    queue.submitted = 0;
+}
+
+void destroyTimeline(VulkanContext* context, VulkanQueue& queue) {
+    vkDestroySemaphore(context->device, queue.timeline, 0);
+    queue.timeline = VK_NULL_HANDLE;
+}
+
+uint64_t completedTimelineValue(VulkanContext* context, const VulkanQueue& queue) {
+    uint64_t value;
+    VAC(vkGetSemaphoreCounterValue(context->device, queue.timeline, &value));
+    return value;
+}
+
+void waitTimeline(VulkanContext* context, const VulkanQueue& queue, uint64_t value) {
+    VkSemaphoreWaitInfo waitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &queue.timeline;
+    waitInfo.pValues = &value;
+    VAC(vkWaitSemaphores(context->device, &waitInfo, UINT64_MAX));
+}
@@ -0,0 +1,305 @@
+#include <deque>
+#include <algorithm>
+#include "vulkan-base.h"
+
+// graphics stages that may consume uploaded data, used for the timeline wait and the acquire barriers
+const VkPipelineStageFlags UPLOAD_CONSUMER_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+struct UploadBatch {
+    VkCommandBuffer commandBuffer;
+    // transfer timeline value signaled by the submission
+    uint64_t timelineValue;
+    uint64_t ringEnd;
+    bool retired;
+    // the release barriers are still needed for the acquire half, so the batch can't be recycled yet
+    bool pendingAcquire;
+    std::vector<VkBufferMemoryBarrier> bufferReleases;
+    std::vector<VkImageMemoryBarrier> imageReleases;
+};
+
+// staging memory is used as a ring, head and tail only grow until the ring drains and both reset to zero
+struct VulkanUploader {
+    VulkanBuffer staging;
+    VkDeviceSize ringSize;
+    uint64_t head;
+    uint64_t tail;
+    VkCommandPool commandPool;
+    bool separateQueue;
+    bool ownershipTransfer;
+    UploadBatch* recording;
+    std::deque<UploadBatch*> inFlight;
+    std::vector<UploadBatch*> unacquired;
+    std::vector<UploadBatch*> available;
+};
+
+void beginUploadBatch(VulkanContext* context, VulkanUploader* uploader) {
+    if (uploader->recording) {
+        return;
+    }
+
+    UploadBatch* batch;
+    if (!uploader->available.empty()) {
+        batch = uploader->available.back();
+        uploader->available.pop_back();
+        VAC(vkResetCommandBuffer(batch->commandBuffer, 0));
+        batch->retired = false;
+        batch->bufferReleases.clear();
+        batch->imageReleases.clear();
+    } else {
+        batch = new UploadBatch {};
+
+        VkCommandBufferAllocateInfo allocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        allocateInfo.commandPool = uploader->commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VAC(vkAllocateCommandBuffers(context->device, &allocateInfo, &batch->commandBuffer));
+    }
+
+    VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VAC(vkBeginCommandBuffer(batch->commandBuffer, &beginInfo));
+
+    uploader->recording = batch;
+}
+
+void retireUploads(VulkanContext* context) {
+    VulkanUploader* uploader = context->uploader;
+    if (uploader->inFlight.empty()) {
+        return;
+    }
+    uint64_t completed = completedTimelineValue(context, context->transferQueue);
+    while (!uploader->inFlight.empty()) {
+        UploadBatch* batch = uploader->inFlight.front();
+        if (batch->timelineValue > completed) {
+            break;
+        }
+        uploader->tail = batch->ringEnd;
+        uploader->inFlight.pop_front();
+        batch->retired = true;
+        if (!batch->pendingAcquire) {
+            uploader->available.push_back(batch);
+        }
+    }
+    if (uploader->inFlight.empty() && !uploader->recording) {
+        uploader->head = 0;
+        uploader->tail = 0;
+    }
+}
+
+void waitOldestUpload(VulkanContext* context) {
+    VulkanUploader* uploader = context->uploader;
+    if (uploader->inFlight.empty()) {
+        flushUploads(context);
+    }
+    if (!uploader->inFlight.empty()) {
+        waitTimeline(context, context->transferQueue, uploader->inFlight.front()->timelineValue);
+    }
+    retireUploads(context);
+}
+
+// returns the staging offset for size bytes, blocking on the oldest batch only when the ring is full
+VkDeviceSize allocateStaging(VulkanContext* context, VkDeviceSize size, VkDeviceSize alignment) {
+    VulkanUploader* uploader = context->uploader;
+    if (size > uploader->ringSize) {
+        throw std::runtime_error("upload larger than the staging ring!");
+    }
+
+    while (true) {
+        uint64_t offset = (uploader->head + alignment - 1) / alignment * alignment;
+        if (offset % uploader->ringSize + size > uploader->ringSize) {
+            offset = (offset / uploader->ringSize + 1) * uploader->ringSize;
+        }
+        if (offset + size - uploader->tail <= uploader->ringSize) {
+            uploader->head = offset + size;
+            return offset % uploader->ringSize;
+        }
+        waitOldestUpload(context);
+    }
+}
+
+void createUploader(VulkanContext* context, VkDeviceSize ringSize) {
+    VulkanUploader* uploader = new VulkanUploader {};
+    uploader->ringSize = ringSize;
+    createBuffer(context, ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploader->staging);
+
+    uploader->separateQueue = context->transferQueue.queue != context->graphicsQueue.queue;
+    uploader->ownershipTransfer = context->transferQueue.familyIndex != context->graphicsQueue.familyIndex;
+
+    VkCommandPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    createInfo.queueFamilyIndex = context->transferQueue.familyIndex;
+    VAC(vkCreateCommandPool(context->device, &createInfo, 0, &uploader->commandPool));
+
+    context->uploader = uploader;
+}
+
+void destroyUploader(VulkanContext* context) {
+    VulkanUploader* uploader = context->uploader;
+    vkDeviceWaitIdle(context->device);
+
+    std::vector<UploadBatch*> batches = uploader->available;
+    batches.insert(batches.end(), uploader->inFlight.begin(), uploader->inFlight.end());
+    batches.insert(batches.end(), uploader->unacquired.begin(), uploader->unacquired.end());
+    if (uploader->recording) {
+        batches.push_back(uploader->recording);
+    }
+    // unacquired batches can still be in flight
+    std::sort(batches.begin(), batches.end());
+    batches.erase(std::unique(batches.begin(), batches.end()), batches.end());
+    for (UploadBatch* batch : batches) {
+        delete batch;
+    }
+    vkDestroyCommandPool(context->device, uploader->commandPool, 0);
+    destroyBuffer(context, uploader->staging);
+
+    delete uploader;
+    context->uploader = nullptr;
+}
+
+void uploadBuffer(VulkanContext* context, VulkanBuffer& buffer, VkDeviceSize offset, const void* data, VkDeviceSize size) {
+    VulkanUploader* uploader = context->uploader;
+    VkDeviceSize chunkSize = uploader->ringSize / 4;
+
+    for (VkDeviceSize copied {0}; copied < size; copied += chunkSize) {
+        VkDeviceSize length = std::min(chunkSize, size - copied);
+        VkDeviceSize stagingOffset = allocateStaging(context, length, 4);
+        memcpy((uint8_t*)uploader->staging.allocation.mapped + stagingOffset, (const uint8_t*)data + copied, (size_t)length);
+
+        beginUploadBatch(context, uploader);
+        VkBufferCopy region = { stagingOffset, offset + copied, length };
+        vkCmdCopyBuffer(uploader->recording->commandBuffer, uploader->staging.buffer, buffer.buffer, 1, &region);
+    }
+
+    if (uploader->ownershipTransfer) {
+        std::vector<VkBufferMemoryBarrier>& releases = uploader->recording->bufferReleases;
+        bool released = false;
+        for (auto& release : releases) {
+            released |= release.buffer == buffer.buffer;
+        }
+        if (!released) {
+            releases.push_back(queueOwnershipBarrier(buffer, context->transferQueue, context->graphicsQueue, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT));
+        }
+    }
+}
+
+void uploadImage(VulkanContext* context, VulkanImage& image, uint32_t mipLevel, const void* data, VkDeviceSize size, VkImageLayout finalLayout) {
+    VulkanUploader* uploader = context->uploader;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(16, context->physicalDeviceProperties.limits.optimalBufferCopyOffsetAlignment);
+    VkDeviceSize stagingOffset = allocateStaging(context, size, alignment);
+    memcpy((uint8_t*)uploader->staging.allocation.mapped + stagingOffset, data, (size_t)size);
+
+    beginUploadBatch(context, uploader);
+    VkCommandBuffer commandBuffer = uploader->recording->commandBuffer;
+
+    VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = stagingOffset;
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, 1 };
+    region.imageExtent = { std::max(1u, image.width >> mipLevel), std::max(1u, image.height >> mipLevel), 1 };
+    vkCmdCopyBufferToImage(commandBuffer, uploader->staging.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // across families the layout change happens as part of the ownership transfer at flush time
+    if (uploader->ownershipTransfer) {
+        barrier = queueOwnershipBarrier(image, context->transferQueue, context->graphicsQueue, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, 1 };
+        uploader->recording->imageReleases.push_back(barrier);
+        return;
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = finalLayout;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+}
+
+// submits every copy recorded since the last flush as one batch on the transfer queue
+// with a shared queue later submissions see the data, otherwise the next acquireUploads hands it over
+void flushUploads(VulkanContext* context) {
+    VulkanUploader* uploader = context->uploader;
+    UploadBatch* batch = uploader->recording;
+    if (!batch) {
+        return;
+    }
+
+    if (uploader->ownershipTransfer) {
+        vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0,
+            (uint32_t)batch->bufferReleases.size(), batch->bufferReleases.data(), (uint32_t)batch->imageReleases.size(), batch->imageReleases.data());
+    } else if (!uploader->separateQueue) {
+        VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+    }
+    VAC(vkEndCommandBuffer(batch->commandBuffer));
+
+    VulkanQueue& queue = context->transferQueue;
+    uint64_t timelineValue = queue.submitted + 1;
+    VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &timelineValue;
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch->commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &queue.timeline;
+    VAC(vkQueueSubmit(queue.queue, 1, &submitInfo, VK_NULL_HANDLE));
+    queue.submitted = timelineValue;
+
+    batch->timelineValue = timelineValue;
+    batch->ringEnd = uploader->head;
+    batch->pendingAcquire = uploader->separateQueue;
+    uploader->inFlight.push_back(batch);
+    if (uploader->separateQueue) {
+        uploader->unacquired.push_back(batch);
+    }
+    uploader->recording = nullptr;
+}
+
+// a single wait on the newest batch covers every older one, the timeline only moves forward
+void acquireUploads(VulkanContext* context, VulkanFrame& frame) {
+    VulkanUploader* uploader = context->uploader;
+    if (uploader->unacquired.empty()) {
+        return;
+    }
+
+    std::vector<VkBufferMemoryBarrier> bufferAcquires;
+    std::vector<VkImageMemoryBarrier> imageAcquires;
+    uint64_t waitValue {0};
+    for (UploadBatch* batch : uploader->unacquired) {
+        bufferAcquires.insert(bufferAcquires.end(), batch->bufferReleases.begin(), batch->bufferReleases.end());
+        imageAcquires.insert(imageAcquires.end(), batch->imageReleases.begin(), batch->imageReleases.end());
+        waitValue = std::max(waitValue, batch->timelineValue);
+        batch->pendingAcquire = false;
+        if (batch->retired) {
+            uploader->available.push_back(batch);
+        }
+    }
+    uploader->unacquired.clear();
+    addFrameWait(frame, context->transferQueue.timeline, UPLOAD_CONSUMER_STAGES, waitValue);
+
+    if (!bufferAcquires.empty() || !imageAcquires.empty()) {
+        vkCmdPipelineBarrier(frame.commandBuffer, UPLOAD_CONSUMER_STAGES, UPLOAD_CONSUMER_STAGES, 0, 0, 0,
+            (uint32_t)bufferAcquires.size(), bufferAcquires.data(), (uint32_t)imageAcquires.size(), imageAcquires.data());
+    }
+}
+
+void waitUploads(VulkanContext* context) {
+    VulkanUploader* uploader = context->uploader;
+    flushUploads(context);
+    while (!uploader->inFlight.empty()) {
+        waitOldestUpload(context);
+    }
+}
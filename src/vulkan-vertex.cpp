@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define VERTEX_F16C
+#include <immintrin.h>
+#endif
+#include "vulkan-base.h"
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff) {
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+    int32_t halfExponent = (int32_t)exponent - 127 + 15;
+    if (halfExponent >= 31) {
+        return (uint16_t)(sign | 0x7c00);
+    }
+
+    uint32_t shift = 13;
+    uint32_t half;
+    if (halfExponent <= 0) {
+        // subnormal, the implicit bit becomes part of the mantissa
+        if (halfExponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        shift = (uint32_t)(14 - halfExponent);
+        half = mantissa >> shift;
+    } else {
+        half = ((uint32_t)halfExponent << 10) | (mantissa >> shift);
+    }
+    // a carry out of the mantissa bumps the exponent, which is the correct rounding up to the next binade or infinity
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+void packHalf(const float* values, uint16_t* packed, size_t count) {
+    size_t i {0};
+#ifdef VERTEX_F16C
+    for (; i + 4 <= count; i += 4) {
+        __m128i halves = _mm_cvtps_ph(_mm_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64((__m128i*)(packed + i), halves);
+    }
+#endif
+    for (; i < count; i++) {
+        packed[i] = floatToHalf(values[i]);
+    }
+}
+
+// nearbyint follows the current rounding mode, the same nearest even the sse conversions use
+void packSnorm16(const float* values, int16_t* packed, size_t count) {
+    size_t i {0};
+#ifdef VERTEX_SSE2
+    const __m128 minimum = _mm_set1_ps(-1.0f);
+    const __m128 maximum = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= count; i += 8) {
+        __m128 low = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), minimum), maximum), scale);
+        __m128 high = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i + 4), minimum), maximum), scale);
+        __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128((__m128i*)(packed + i), words);
+    }
+#endif
+    for (; i < count; i++) {
+        packed[i] = (int16_t)std::nearbyint(std::clamp(values[i], -1.0f, 1.0f) * 32767.0f);
+    }
+}
+
+void packUnorm8(const float* values, uint8_t* packed, size_t count) {
+    size_t i {0};
+#ifdef VERTEX_SSE2
+    const __m128 minimum = _mm_setzero_ps();
+    const __m128 maximum = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; i + 16 <= count; i += 16) {
+        __m128i quarters[4];
+        for (size_t j {0}; j < 4; j++) {
+            __m128 value = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i + 4 * j), minimum), maximum), scale);
+            quarters[j] = _mm_cvtps_epi32(value);
+        }
+        __m128i low = _mm_packs_epi32(quarters[0], quarters[1]);
+        __m128i high = _mm_packs_epi32(quarters[2], quarters[3]);
+        _mm_storeu_si128((__m128i*)(packed + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++) {
+        packed[i] = (uint8_t)std::nearbyint(std::clamp(values[i], 0.0f, 1.0f) * 255.0f);
+    }
+}
+
+void foldOctahedral(const glm::vec3& normal, float* folded) {
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    float x = length > 0.0f ? normal.x / length : 0.0f;
+    float y = length > 0.0f ? normal.y / length : 0.0f;
+    if (normal.z < 0.0f) {
+        float foldedX = std::copysign(1.0f - std::abs(y), x);
+        y = std::copysign(1.0f - std::abs(x), y);
+        x = foldedX;
+    }
+    folded[0] = x;
+    folded[1] = y;
+}
+
+// the fold runs four normals at a time, quantizing is left to packSnorm16
+void packOctahedral(const glm::vec3* normals, int16_t* packed, size_t count) {
+    std::vector<float> folded(2 * count);
+    size_t i {0};
+#ifdef VERTEX_SSE2
+    const __m128 absolute = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        const glm::vec3* n = normals + i;
+        __m128 x = _mm_setr_ps(n[0].x, n[1].x, n[2].x, n[3].x);
+        __m128 y = _mm_setr_ps(n[0].y, n[1].y, n[2].y, n[3].y);
+        __m128 z = _mm_setr_ps(n[0].z, n[1].z, n[2].z, n[3].z);
+        __m128 length = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absolute), _mm_and_ps(y, absolute)), _mm_and_ps(z, absolute));
+        // zero length normals end up at the origin like in the scalar path
+        __m128 valid = _mm_cmpgt_ps(length, zero);
+        __m128 inverse = _mm_and_ps(valid, _mm_div_ps(one, _mm_or_ps(_mm_andnot_ps(valid, one), length)));
+        x = _mm_mul_ps(x, inverse);
+        y = _mm_mul_ps(y, inverse);
+
+        __m128 foldedX = _mm_or_ps(_mm_sub_ps(one, _mm_and_ps(y, absolute)), _mm_and_ps(x, signBit));
+        __m128 foldedY = _mm_or_ps(_mm_sub_ps(one, _mm_and_ps(x, absolute)), _mm_and_ps(y, signBit));
+        __m128 lower = _mm_cmplt_ps(z, zero);
+        x = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, x));
+        y = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, y));
+
+        _mm_storeu_ps(folded.data() + 2 * i, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(folded.data() + 2 * i + 4, _mm_unpackhi_ps(x, y));
+    }
+#endif
+    for (; i < count; i++) {
+        foldOctahedral(normals[i], folded.data() + 2 * i);
+    }
+    packSnorm16(folded.data(), packed, 2 * count);
+}
+
+// split into flat component arrays first so every attribute goes through the wide conversions
+void packVertices(const Vertex* vertices, PackedVertex* packed, size_t count) {
+    std::vector<float> positions(2 * count);
+    std::vector<float> colors(4 * count);
+    for (size_t i {0}; i < count; i++) {
+        positions[2 * i] = vertices[i].position.x;
+        positions[2 * i + 1] = vertices[i].position.y;
+        colors[4 * i] = vertices[i].color.x;
+        colors[4 * i + 1] = vertices[i].color.y;
+        colors[4 * i + 2] = vertices[i].color.z;
+        colors[4 * i + 3] = 1.0f;
+    }
+
+    std::vector<uint16_t> halfPositions(2 * count);
+    std::vector<uint8_t> byteColors(4 * count);
+    packHalf(positions.data(), halfPositions.data(), positions.size());
+    packUnorm8(colors.data(), byteColors.data(), colors.size());
+    for (size_t i {0}; i < count; i++) {
+        memcpy(packed[i].position, halfPositions.data() + 2 * i, sizeof(packed[i].position));
+        memcpy(packed[i].color, byteColors.data() + 4 * i, sizeof(packed[i].color));
+    }
+}
+
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices) {
+    std::vector<PackedVertex> packed(vertices.size());
+    packVertices(vertices.data(), packed.data(), vertices.size());
+    return packed;
+}
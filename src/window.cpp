@@ -1,6 +1,4 @@
 #define GLFW_INCLUDE_VULKAN
-#define VK_USE_PLATFORM_WIN32_KHR
-#define GLFW_EXPOSE_NATIVE_WIN32
 #include "window.h"
 
 void framebufferResizeCallback(GLFWwindow *window, int width, int height) {
@@ -12,7 +10,8 @@ void framebufferResizeCallback(GLFWwindow *window, int width, int height) {
     }
 }
 
-Window::Window(const uint16_t width, const uint16_t height, const std::string_view title) : width(width), height(height) {    
+Window::Window(const uint16_t width, const uint16_t height, const std::string_view title, VulkanPresentPolicy presentPolicy, VkSampleCountFlagBits samples, bool depthPrepass)
+    : depthPrepass(depthPrepass), samples(samples), presentPolicy(presentPolicy), width(width), height(height) {    
     if (!glfwInit()) {
         throw std::runtime_error("error while initializing glfw");
     }
@@ -35,7 +34,7 @@ Window::Window(const uint16_t width, const uint16_t height, const std::string_vi
         {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
     };
 
-    createVertexBuffer(context, vertices, &vertexBuffer, &vertexBufferMemory);
+    createVertexBuffer(context, vertices, vertexBuffer);
 }
 
 void Window::setupVulkan() {
@@ -43,15 +42,55 @@ void Window::setupVulkan() {
 
     VAC(glfwCreateWindowSurface(context->instance, window, nullptr, &surface));
 
-    createSwapchain(context, surface, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, swapchain);    
-    createRenderPass(context, swapchain.format, renderPass);
-    createFramebuffers(context, swapchain, renderPass, framebuffers);
-    createPipeline(context, "spvs/default-vert.spv", "spvs/default-frag.spv", renderPass, swapchain.width, swapchain.height, pipeline);
-    createFence(context, fence);
-    createSemaphore(context, acquireSemaphore);
-    createSemaphore(context, releaseSemaphore);
-    createCommandPool(context, &commandPool);
-    allocateCommandBuffers(context, commandPool, commandBuffer);
+    createSwapchain(context, surface, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, swapchain, presentPolicy);    
+    samples = chooseSampleCount(context, samples);
+    depthFormat = chooseDepthFormat(context);
+    dynamicRendering = context->features.dynamicRendering;
+    if (dynamicRendering) {
+        renderPass = VK_NULL_HANDLE;
+        pipelineDescription = defaultPipelineDescription("spvs/default-vert.spv", "spvs/default-frag.spv", swapchain.format);
+        createRenderGraph(context, renderGraph);
+    } else {
+        createRenderPass(context, swapchain.format, depthFormat, samples, renderPass);
+        createAttachments();
+        pipelineDescription = defaultPipelineDescription("spvs/default-vert.spv", "spvs/default-frag.spv", renderPass);
+    }
+    pipelineDescription.depthFormat = depthFormat;
+    pipelineDescription.samples = samples;
+    pipelineDescription.depthTest = true;
+    pipelineDescription.depthWrite = !depthPrepass;
+    pipelineDescription.depthCompareOp = depthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
+    requestPipeline(context, pipelineDescription);
+    if (depthPrepass) {
+        // same vertex stage and state, so both passes produce bit identical depth
+        prepassDescription = pipelineDescription;
+        prepassDescription.fragmentShader.clear();
+        if (dynamicRendering) {
+            prepassDescription.colorFormat = VK_FORMAT_UNDEFINED;
+        }
+        prepassDescription.depthWrite = true;
+        prepassDescription.depthCompareOp = VK_COMPARE_OP_LESS;
+        requestPipeline(context, prepassDescription);
+    }
+    createFrames(context, frames);
+}
+
+// depth and multisampled color for the render pass path, recreated with the swapchain
+void Window::createAttachments() {
+    if (depthImage.image != VK_NULL_HANDLE) {
+        deferDestroyImage(context, depthImage);
+    }
+    if (colorImage.image != VK_NULL_HANDLE) {
+        deferDestroyImage(context, colorImage);
+    }
+    std::vector<VkImageView> sharedAttachments;
+    createAttachmentImage(context, swapchain.width, swapchain.height, depthFormat, samples, depthImage);
+    sharedAttachments.push_back(depthImage.imageView);
+    if (samples != VK_SAMPLE_COUNT_1_BIT) {
+        createAttachmentImage(context, swapchain.width, swapchain.height, swapchain.format, samples, colorImage);
+        sharedAttachments.push_back(colorImage.imageView);
+    }
+    createFramebuffers(context, swapchain.imageViews, swapchain.width, swapchain.height, renderPass, framebuffers, sharedAttachments);
 }
 
 void Window::run() {
@@ -59,6 +98,7 @@ void Window::run() {
     double lastTime {.0};
     double elapsedTime {.0};
     double fpsTimer {.0};
+    double summaryTimer {.0};
 
     while(!glfwWindowShouldClose(window)) {
         double currentTime = glfwGetTime();
@@ -66,105 +106,171 @@ void Window::run() {
         lastTime = currentTime;
         elapsedTime += deltaTime;
         fpsTimer += deltaTime;
+        summaryTimer += deltaTime;
         if (fpsTimer >= 1.) {
             LOG(LOG_DEFAULT_UTILS, 0, "FPS: %f (%fms)", 1.0f/deltaTime, deltaTime * 1000.f);
+            if (latencySamples > 0) {
+                LOG(LOG_DEFAULT_UTILS, 0, "input to display: %fms", latencySum / latencySamples);
+                latencySum = .0;
+                latencySamples = 0;
+            }
             fpsTimer = .0;
         }
+        if (summaryTimer >= 5.) {
+            logProfilerSummary(context);
+            summaryTimer = .0;
+        }
+
+        // at most one frame waits for the display, so input is sampled as late as possible
+        double latency = pacePresents(context, swapchain, 1);
+        if (latency >= .0) {
+            latencySum += latency;
+            latencySamples++;
+        }
 
         glfwPollEvents();
+        pollShaderLibrary(context);
+        frameStartTime = glfwGetTime();
         
         {
             if (Input::isKeyDown(GLFW_KEY_ESCAPE))
                 glfwSetWindowShouldClose(window, true);
         }
         
+        beginCpuScope(context, "frame");
         render();
+        endCpuScope(context);
     }
     clean();
 }
 
-uint32_t frameIndex = 0;
-
 void Window::render() {
     uint32_t imageIndex {0};
+    VulkanFrame& frame = frames[frameIndex];
+
+    // the framebuffers carry the depth and msaa attachments, so they are rebuilt here instead of by recreateSwapchain
+    auto recreate = [&]() {
+        VkRenderPass swapchainRenderPass = VK_NULL_HANDLE;
+        recreateSwapchain(window, context, swapchain, framebuffers, surface, swapchainRenderPass);
+        if (!dynamicRendering) {
+            createAttachments();
+        }
+    };
 
-    vkWaitForFences(context->device, 1, &fence[frameIndex], VK_TRUE, UINT64_MAX);
+    waitFrame(context, frame);
 
-    VkResult result = vkAcquireNextImageKHR(context->device, swapchain.swapchain, UINT64_MAX, acquireSemaphore[frameIndex], 0, &imageIndex);
+    VkResult result = vkAcquireNextImageKHR(context->device, swapchain.swapchain, UINT64_MAX, frame.acquireSemaphore, 0, &imageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         framebufferResized = false;
-        recreateSwapchain(window, context, swapchain, framebuffers, surface, renderPass);
+        recreate();
         return;
     } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("failed to acquire swapchain image!");
     }    
 
-    vkResetFences(context->device, 1, &fence[frameIndex]);
-
-    vkResetCommandBuffer(commandBuffer[frameIndex], 0);
-
-    VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    vkBeginCommandBuffer(commandBuffer[frameIndex], &beginInfo);
+    beginFrame(context, frame);
+    addFrameWait(frame, frame.acquireSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
     {
         VkClearValue clearValue = {1.0f, 0.0f, 1.0f, 1.0f};
-        VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-        beginInfo.renderPass = renderPass;
-        beginInfo.framebuffer = framebuffers[imageIndex];
-        beginInfo.renderArea = { {0, 0}, {swapchain.width, swapchain.height}};
-        beginInfo.clearValueCount = 1;
-        beginInfo.pClearValues = &clearValue;
-        vkCmdBeginRenderPass(commandBuffer[frameIndex], &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        VkClearValue depthClearValue = {};
+        depthClearValue.depthStencil = {1.0f, 0};
+        VkRect2D renderArea = { {0, 0}, {swapchain.width, swapchain.height}};
+
+        // the frame only clears until the pipelines finished compiling in the background
+        const VulkanPipeline* pipeline = requestPipeline(context, pipelineDescription);
+        const VulkanPipeline* prepassPipeline = depthPrepass ? requestPipeline(context, prepassDescription) : nullptr;
+        // with the prepass the main pass only passes the equal test where the prepass wrote depth
+        bool ready = pipeline && (!depthPrepass || prepassPipeline);
+        auto drawTriangles = [&](VkCommandBuffer commandBuffer, const VulkanPipeline* pipeline, uint32_t firstDraw, uint32_t drawCount) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline);
         
-        vkCmdBindPipeline(commandBuffer[frameIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
-        
-        VkViewport viewport;
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = width;
-        viewport.height = height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        vkCmdSetViewport(commandBuffer[frameIndex], 0, 1, &viewport);
-
-        VkRect2D scissor;
-        scissor.offset = {0, 0};
-        scissor.extent = {width, height};
-        vkCmdSetScissor(commandBuffer[frameIndex], 0, 1, &scissor);
-
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer[frameIndex], 0, 1, vertexBuffers, offsets);
-
-        vkCmdDraw(commandBuffer[frameIndex], static_cast<uint32_t>(3), 1, 0, 0);
-
-        vkCmdEndRenderPass(commandBuffer[frameIndex]);
+            VkViewport viewport;
+            viewport.x = 0.0f;
+            viewport.y = 0.0f;
+            viewport.width = width;
+            viewport.height = height;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+            VkRect2D scissor;
+            scissor.offset = {0, 0};
+            scissor.extent = {width, height};
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+            VkBuffer vertexBuffers[] = {vertexBuffer.buffer};
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+            for (uint32_t i {firstDraw}; i < firstDraw + drawCount; i++) {
+                vkCmdDraw(commandBuffer, static_cast<uint32_t>(3), 1, 0, 0);
+            }
+        };
+        auto draw = [&](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+            drawTriangles(commandBuffer, pipeline, firstDraw, drawCount);
+        };
+        auto drawPrepass = [&](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+            drawTriangles(commandBuffer, prepassPipeline, firstDraw, drawCount);
+        };
+
+        if (dynamicRendering) {
+            // the wait on the acquire semaphore happens at color attachment output, the first barrier has to start there too
+            resetRenderGraph(renderGraph);
+            VulkanGraphResource backbuffer = importGraphImage(renderGraph, "backbuffer", swapchain.images[imageIndex], swapchain.imageViews[imageIndex], swapchain.format,
+                swapchain.width, swapchain.height, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, clearValue);
+            // nothing culls here, so depth stays transient and is never stored; occlusion culling needs a stored single sampled depth image
+            VulkanGraphResource depth = createGraphImage(renderGraph, "depth", swapchain.width, swapchain.height, depthFormat, depthClearValue, samples);
+
+            if (depthPrepass) {
+                VulkanGraphPass prepass = {};
+                prepass.name = "depth prepass";
+                prepass.uses = { { depth, GRAPH_ACCESS_DEPTH_ATTACHMENT } };
+                prepass.drawCount = ready ? 1 : 0;
+                prepass.record = drawPrepass;
+                addGraphPass(renderGraph, prepass);
+            }
+
+            VulkanGraphPass mainPass = {};
+            mainPass.name = "main";
+            mainPass.uses = { { depth, depthPrepass ? GRAPH_ACCESS_DEPTH_READ : GRAPH_ACCESS_DEPTH_ATTACHMENT } };
+            if (samples != VK_SAMPLE_COUNT_1_BIT) {
+                // multisampled color stays in tile memory and is resolved into the backbuffer at the end of the pass
+                VulkanGraphResource color = createGraphImage(renderGraph, "msaa color", swapchain.width, swapchain.height, swapchain.format, clearValue, samples);
+                mainPass.uses.push_back({ color, GRAPH_ACCESS_COLOR_ATTACHMENT });
+                mainPass.uses.push_back({ backbuffer, GRAPH_ACCESS_COLOR_RESOLVE });
+            } else {
+                mainPass.uses.push_back({ backbuffer, GRAPH_ACCESS_COLOR_ATTACHMENT });
+            }
+            mainPass.drawCount = ready ? 1 : 0;
+            mainPass.record = draw;
+            addGraphPass(renderGraph, mainPass);
+
+            executeRenderGraph(context, renderGraph, frame);
+        } else {
+            // attachments are backbuffer, depth and the multisampled color, the backbuffer clear is unused with msaa
+            VkClearValue clearValues[] = { clearValue, depthClearValue, clearValue };
+            VkRenderPassBeginInfo beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+            beginInfo.renderPass = renderPass;
+            beginInfo.framebuffer = framebuffers[imageIndex];
+            beginInfo.renderArea = renderArea;
+            beginInfo.clearValueCount = samples != VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
+            beginInfo.pClearValues = clearValues;
+            // prepass and main draws share the subpass, the prepass pipeline leaves color alone
+            recordRenderPass(context, frameIndex, frame.commandBuffer, beginInfo, ready ? 1 : 0, [&](VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+                if (depthPrepass) {
+                    drawPrepass(commandBuffer, firstDraw, drawCount);
+                }
+                draw(commandBuffer, firstDraw, drawCount);
+            });
+        }
     }
-    vkEndCommandBuffer(commandBuffer[frameIndex]);
-
-    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer[frameIndex];
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &acquireSemaphore[frameIndex];
-    VkPipelineStageFlags waitMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    submitInfo.pWaitDstStageMask = &waitMask;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &releaseSemaphore[frameIndex];
-    vkQueueSubmit(context->graphicsQueue.queue, 1, &submitInfo, fence[frameIndex]);
-
-    VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &swapchain.swapchain;
-    presentInfo.pImageIndices = &imageIndex;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &releaseSemaphore[frameIndex];
-
-    result = vkQueuePresentKHR(context->graphicsQueue.queue, &presentInfo);
+    submitFrame(context, frame, true);
+
+    result = presentSwapchain(context, swapchain, imageIndex, frame.releaseSemaphore, frameStartTime);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
-        recreateSwapchain(window, context, swapchain, framebuffers, surface, renderPass);
+        recreate();
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swapchain image!");
     }   
@@ -173,18 +279,28 @@ void Window::render() {
 }
 
 void Window::clean() {
-    vkDeviceWaitIdle(context->device);
-    
+    flushDeletions(context);
+
+    logMemoryStats(context);
+
     destroyVertexBuffer(context, vertexBuffer);
-    vkFreeMemory(context->device, vertexBufferMemory, 0);
 
     destroySwapchain(context, &swapchain, framebuffers);
+    if (depthImage.image != VK_NULL_HANDLE) {
+        destroyImage(context, depthImage);
+    }
+    if (colorImage.image != VK_NULL_HANDLE) {
+        destroyImage(context, colorImage);
+    }
 
-    destroyPipeline(context, &pipeline);
-    destroyRenderpass(context, renderPass);
+    if (renderPass != VK_NULL_HANDLE) {
+        destroyRenderpass(context, renderPass);
+    }
+    if (renderGraph) {
+        destroyRenderGraph(context, renderGraph);
+    }
 
-    destroySyncObjects(context, acquireSemaphore, releaseSemaphore, fence);
-    vkDestroyCommandPool(context->device, commandPool, 0);
+    destroyFrames(context, frames);
     
     vkDestroySurfaceKHR(context->instance, surface, 0);
     
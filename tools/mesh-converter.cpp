@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include "vulkan-base.h"
+
+// post transform cache the optimizer targets and the statistics simulate, a common fifo size on current gpus
+const uint32_t VERTEX_CACHE_SIZE = 16;
+// a lod has to drop at least this share of the triangles of the previous one to be kept
+const float LOD_MIN_REDUCTION = 0.3f;
+
+struct ConverterOptions {
+    std::string input;
+    std::string output;
+    uint32_t lodCount {MAX_MESH_LODS};
+    bool optimize {true};
+};
+
+struct SourceMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+ConverterOptions parseOptions(int argc, char** argv) {
+    ConverterOptions options;
+    std::vector<std::string> files;
+    for (int i {1}; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--lods" && hasValue) {
+            options.lodCount = std::clamp<uint32_t>((uint32_t)std::stoul(argv[++i]), 1, MAX_MESH_LODS);
+        } else if (argument == "--no-optimize") {
+            options.optimize = false;
+        } else if (argument.rfind("--", 0) == 0) {
+            throw std::runtime_error("unknown argument: " + argument);
+        } else {
+            files.push_back(argument);
+        }
+    }
+    if (files.size() != 2) {
+        throw std::runtime_error("usage: vulkan_cpp_mesh_converter input.obj output.mesh [--lods n] [--no-optimize]");
+    }
+    options.input = files[0];
+    options.output = files[1];
+    return options;
+}
+
+// obj vertices may carry a color after the position ("v x y z r g b"), faces are fanned into triangles
+// the vertex format is 2d, so z only matters for the file being valid obj
+SourceMesh parseObj(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("could not open " + filename);
+    }
+
+    SourceMesh mesh;
+    std::string line;
+    uint32_t lineNumber {0};
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+        if (type == "v") {
+            float x {0}, y {0}, z {0};
+            float r {1}, g {1}, b {1};
+            stream >> x >> y >> z;
+            if (!(stream >> r >> g >> b)) {
+                r = g = b = 1.0f;
+            }
+            mesh.vertices.push_back({ { x, y }, { r, g, b } });
+        } else if (type == "f") {
+            std::vector<uint32_t> face;
+            std::string corner;
+            while (stream >> corner) {
+                // only the position index of "v/vt/vn" is used
+                long index = std::stol(corner.substr(0, corner.find('/')));
+                long resolved = index < 0 ? (long)mesh.vertices.size() + index : index - 1;
+                if (resolved < 0 || resolved >= (long)mesh.vertices.size()) {
+                    throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": vertex index out of range");
+                }
+                face.push_back((uint32_t)resolved);
+            }
+            for (size_t i {2}; i < face.size(); i++) {
+                mesh.indices.insert(mesh.indices.end(), { face[0], face[i - 1], face[i] });
+            }
+        }
+    }
+    if (mesh.indices.empty()) {
+        throw std::runtime_error(filename + " has no faces");
+    }
+    return mesh;
+}
+
+// average misses per triangle of a fifo cache, 3 is no reuse at all and 0.5 the best a regular grid allows
+double cacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    std::vector<uint64_t> insertedAt(vertexCount, 0);
+    uint64_t insertions {0};
+    uint64_t misses {0};
+    for (uint32_t index : indices) {
+        if (insertedAt[index] == 0 || insertions - insertedAt[index] >= VERTEX_CACHE_SIZE) {
+            insertedAt[index] = ++insertions;
+            misses++;
+        }
+    }
+    return indices.empty() ? 0.0 : (double)misses / (indices.size() / 3);
+}
+
+// tipsify (sander, nehab and barczak 2007): fans out around one vertex at a time and moves on to the neighbour
+// that is still in the cache and has the fewest triangles left, linear in the triangle count
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    uint32_t triangleCount = (uint32_t)indices.size() / 3;
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) {
+        liveTriangles[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t i {0}; i < vertexCount; i++) {
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t i {0}; i < indices.size(); i++) {
+        adjacency[filled[indices[i]]++] = i / 3;
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> optimized;
+    optimized.reserve(indices.size());
+    uint32_t time = VERTEX_CACHE_SIZE + 1;
+    uint32_t cursor {0};
+
+    int64_t fanning = indices.empty() ? -1 : indices[0];
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t i {adjacencyOffsets[fanning]}; i < adjacencyOffsets[fanning + 1]; i++) {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (uint32_t corner {0}; corner < 3; corner++) {
+                uint32_t vertex = indices[3 * triangle + corner];
+                optimized.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+
+        // the candidate that stays in the cache for all of its remaining triangles and entered it earliest
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            int64_t priority {0};
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= VERTEX_CACHE_SIZE) {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = vertex;
+            }
+        }
+        // dead end, continue with a recently used vertex or the next one in input order
+        while (fanning < 0 && !deadEnds.empty()) {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                fanning = vertex;
+            }
+        }
+        while (fanning < 0 && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                fanning = cursor;
+            }
+            cursor++;
+        }
+    }
+    return optimized;
+}
+
+// vertex clustering on a grid of cellSize: every cell collapses into the vertex closest to its average, triangles that
+// lose a corner or end up duplicated are dropped. crude next to edge collapse, but fast and never changes the topology
+// of what survives
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, float cellSize) {
+    std::unordered_map<uint64_t, uint32_t> cells;
+    std::vector<uint32_t> cluster(vertices.size(), UINT32_MAX);
+    std::vector<glm::vec2> sums;
+    std::vector<uint32_t> counts;
+    for (uint32_t index : indices) {
+        if (cluster[index] != UINT32_MAX) {
+            continue;
+        }
+        const glm::vec2& position = vertices[index].position;
+        uint64_t key = ((uint64_t)(uint32_t)(int32_t)std::floor(position.x / cellSize) << 32) | (uint32_t)(int32_t)std::floor(position.y / cellSize);
+        auto [cell, inserted] = cells.emplace(key, (uint32_t)sums.size());
+        if (inserted) {
+            sums.push_back(glm::vec2(0.0f));
+            counts.push_back(0);
+        }
+        cluster[index] = cell->second;
+        sums[cell->second] = sums[cell->second] + position;
+        counts[cell->second]++;
+    }
+
+    std::vector<uint32_t> representative(sums.size(), UINT32_MAX);
+    std::vector<float> bestDistance(sums.size(), INFINITY);
+    for (uint32_t i {0}; i < vertices.size(); i++) {
+        if (cluster[i] == UINT32_MAX) {
+            continue;
+        }
+        glm::vec2 offset = vertices[i].position - sums[cluster[i]] * (1.0f / counts[cluster[i]]);
+        float distance = offset.x * offset.x + offset.y * offset.y;
+        if (distance < bestDistance[cluster[i]]) {
+            bestDistance[cluster[i]] = distance;
+            representative[cluster[i]] = i;
+        }
+    }
+
+    std::vector<uint32_t> simplified;
+    std::set<std::array<uint32_t, 3>> seen;
+    for (size_t i {0}; i < indices.size(); i += 3) {
+        std::array<uint32_t, 3> triangle = {
+            representative[cluster[indices[i]]],
+            representative[cluster[indices[i + 1]]],
+            representative[cluster[indices[i + 2]]]
+        };
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+            continue;
+        }
+        // rotated so the smallest index leads, which keeps the winding and makes duplicates compare equal
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        if (seen.insert(triangle).second) {
+            simplified.insert(simplified.end(), triangle.begin(), triangle.end());
+        }
+    }
+    return simplified;
+}
+
+// renumbers vertices in the order the lods first use them so the fetches walk through memory, unused ones are dropped
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>>& lods) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (auto& indices : lods) {
+        for (uint32_t& index : indices) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = (uint32_t)ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+    }
+    vertices = std::move(ordered);
+}
+
+void writeMeshFile(const std::string& filename, const std::vector<Vertex>& vertices, const std::vector<std::vector<uint32_t>>& lods, const std::vector<float>& errors) {
+    VulkanMeshFileHeader header = {};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexStride = sizeof(PackedVertex);
+    header.vertexCount = (uint32_t)vertices.size();
+    header.lodCount = (uint32_t)lods.size();
+    for (uint32_t i {0}; i < header.lodCount; i++) {
+        header.lods[i] = { header.indexCount, (uint32_t)lods[i].size(), errors[i], 0 };
+        header.indexCount += (uint32_t)lods[i].size();
+    }
+    for (auto& vertex : vertices) {
+        header.radius = std::max(header.radius, glm::length(vertex.position));
+    }
+    auto align = [](uint64_t offset) {
+        return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    };
+    header.vertexOffset = align(sizeof(header));
+    header.indexOffset = align(header.vertexOffset + sizeof(PackedVertex) * (uint64_t)vertices.size());
+
+    std::vector<PackedVertex> packed = packVertices(vertices);
+    std::vector<uint8_t> data(header.indexOffset + sizeof(uint32_t) * (uint64_t)header.indexCount, 0);
+    memcpy(data.data(), &header, sizeof(header));
+    memcpy(data.data() + header.vertexOffset, packed.data(), sizeof(PackedVertex) * packed.size());
+    uint8_t* indexData = data.data() + header.indexOffset;
+    for (auto& indices : lods) {
+        memcpy(indexData, indices.data(), sizeof(uint32_t) * indices.size());
+        indexData += sizeof(uint32_t) * indices.size();
+    }
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file || fwrite(data.data(), 1, data.size(), file) != data.size()) {
+        if (file) {
+            fclose(file);
+        }
+        throw std::runtime_error("could not write " + filename);
+    }
+    fclose(file);
+}
+
+// obj in, engine mesh file out: lods by vertex clustering, each lod ordered for the post transform cache and the
+// vertices for fetch locality. there is no overdraw pass, the vertex format has no depth to sort triangles by
+int main(int argc, char** argv) {
+    enableAnsiColors();
+    try {
+        ConverterOptions options = parseOptions(argc, argv);
+        SourceMesh mesh = parseObj(options.input);
+        uint32_t vertexCount = (uint32_t)mesh.vertices.size();
+
+        float radius {0.0f};
+        for (auto& vertex : mesh.vertices) {
+            radius = std::max(radius, glm::length(vertex.position));
+        }
+
+        std::vector<std::vector<uint32_t>> lods = { mesh.indices };
+        std::vector<float> errors = { 0.0f };
+        // the grid gets 4x coarser per lod, the error is the cell size relative to the radius
+        for (uint32_t cells {64}; lods.size() < options.lodCount && cells >= 2 && radius > 0.0f; cells /= 4) {
+            float cellSize = 2.0f * radius / cells;
+            std::vector<uint32_t> simplified = simplifyMesh(mesh.vertices, mesh.indices, cellSize);
+            if (simplified.empty() || simplified.size() > (1.0f - LOD_MIN_REDUCTION) * lods.back().size()) {
+                continue;
+            }
+            lods.push_back(std::move(simplified));
+            errors.push_back(cellSize / radius);
+        }
+
+        for (size_t i {0}; i < lods.size(); i++) {
+            double before = cacheMissRatio(lods[i], vertexCount);
+            if (options.optimize) {
+                lods[i] = optimizeVertexCache(lods[i], vertexCount);
+            }
+            LOG(LOG_DEFAULT_UTILS, false, "lod %zu: %zu triangles, error %.4f, acmr %.3f -> %.3f", i, lods[i].size() / 3, errors[i], before, cacheMissRatio(lods[i], vertexCount));
+        }
+        if (options.optimize) {
+            optimizeVertexFetch(mesh.vertices, lods);
+        }
+
+        writeMeshFile(options.output, mesh.vertices, lods, errors);
+        LOG(LOG_DEFAULT_UTILS, false, "wrote %s: %zu vertices, %zu lods", options.output.c_str(), mesh.vertices.size(), lods.size());
+    } catch(std::exception& exception) {
+        LOG(LOG_ERROR_UTILS, false, "std::exception: %s", exception.what());
+        return 1;
+    }
+    return 0;
+}